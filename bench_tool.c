@@ -0,0 +1,369 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "cards.h"
+#include "layout.h"
+#include "rules.h"
+#include "solver.h"
+#include "table.h"
+
+/*
+ * Times the game's hot paths on the same inputs every run: tables reached by
+ * seeded random play, and seeded mouse positions over them. Needs SDL's
+ * headers for the layout code, but none of its library.
+ */
+
+/* The flags the timed code was built with, set by the Makefile */
+#ifndef BENCH_CFLAGS
+#define BENCH_CFLAGS "unknown"
+#endif
+
+/* Tables to take inputs from, each a different deal played a little further */
+#define NUM_TABLES 32
+#define MAX_INPUTS (NUM_TABLES * NUM_PILES * DECK_SIZE)
+
+/* The window the layout is timed in, as update_graphics would set it up */
+#define WINDOW_WIDTH 1280
+#define WINDOW_HEIGHT 720
+
+static void usage()
+{
+    printf("usage: spider-bench [--runs N] [--warmup N] [--json]\n");
+    printf("Times each function N times after warming it up, and prints the median time per\n");
+    printf("call in ns with the median absolute deviation from it. --json prints the same for\n");
+    printf("diffing between commits, with a checksum of what the calls returned.\n");
+}
+
+/* Seeded, so the inputs are the same on every run */
+static uint32_t next_random(uint64_t *state)
+{
+    *state = *state * 6364136223846793005ull + 1442695040888963407ull;
+    return *state >> 33;
+}
+
+/* A pile and a card in it */
+typedef struct {
+    Pile *pile;
+    int idx;
+} CardInput;
+
+/* Two piles, and how many cards to move from the first */
+typedef struct {
+    Pile *src;
+    Pile *dst;
+    int count;
+} PairInput;
+
+typedef struct {
+    Pile tables[NUM_TABLES][NUM_PILES];
+    Pile deal_piles[NUM_DEALS];
+    /* Every table's piles with a king to ace run on top, for check_complete */
+    Pile runs[NUM_TABLES][NUM_PILES];
+    /* What the player would hold picking up each pile's face-up cards */
+    Pile holding[NUM_TABLES][NUM_PILES];
+    Pile goal;
+    Graphics graphics;
+    SDL_Rect rects[NUM_PILES];
+
+    CardInput cards[MAX_INPUTS];
+    int num_cards;
+    PairInput places[NUM_TABLES * NUM_PILES * NUM_PILES];
+    int num_places;
+    PairInput moves[NUM_TABLES * NUM_PILES * NUM_PILES];
+    int num_moves;
+    Pile *complete[NUM_TABLES * NUM_PILES * 2];
+    int num_complete;
+    /* Mouse positions, each paired with the table it's over */
+    int mouse[MAX_INPUTS][3];
+    int num_mouse;
+} Inputs;
+
+static void make_inputs(Inputs *in)
+{
+    memset(in, 0, sizeof(*in));
+    uint64_t random = 1;
+
+    Graphics *graphics = &in->graphics;
+    graphics->width = WINDOW_WIDTH;
+    graphics->height = WINDOW_HEIGHT;
+    graphics->margin = graphics->width / 100;
+    graphics->card_w = graphics->width / NUM_PILES;
+    graphics->card_h = graphics->card_w * 7 / 5;
+    for (int i = 0; i < NUM_PILES; i++) {
+        /* As spider.c lays them out, without make_rect and so SDL's library */
+        in->rects[i] = (SDL_Rect){
+            graphics->width / NUM_PILES * i,
+            graphics->card_h,
+            graphics->width / NUM_PILES,
+            graphics->height - graphics->card_h
+        };
+    }
+
+    static const int SUITS[] = { 1, 2, 4 };
+    for (int t = 0; t < NUM_TABLES; t++) {
+        Position pos;
+        deal_position(&pos, t + 1, SUITS[t % 3]);
+        for (int i = 0; i < t * 4; i++) {
+            Move moves[MAX_MOVES];
+            int num_moves = legal_moves(&pos, moves);
+            if (num_moves == 0) {
+                break;
+            }
+            apply_move(&pos, moves[next_random(&random) % num_moves]);
+        }
+        Pile *piles = in->tables[t];
+        set_table(&pos, piles, in->deal_piles);
+
+        for (int i = 0; i < NUM_PILES; i++) {
+            Pile *pile = &piles[i];
+            int facedown_idx = get_facedown_idx(pile);
+            for (int j = 0; j < pile->num_cards; j++) {
+                in->cards[in->num_cards++] = (CardInput){ pile, j };
+            }
+
+            in->holding[t][i].num_cards = pile->num_cards - facedown_idx;
+            if (pile->num_cards > 0) {
+                in->holding[t][i].cards[0] = pile->cards[facedown_idx];
+            }
+
+            /* The top card is always face up, so the run never turns one over */
+            Pile *run = &in->runs[t][i];
+            *run = *pile;
+            int suit = next_random(&random) % SUITS[t % 3];
+            for (int rank = 12; rank >= 0; rank--) {
+                run->cards[run->num_cards++] = (Card){ suit, rank, FACEUP };
+            }
+            in->complete[in->num_complete++] = pile;
+            in->complete[in->num_complete++] = run;
+        }
+
+        for (int i = 0; i < NUM_PILES; i++) {
+            for (int j = 0; j < NUM_PILES; j++) {
+                if (i == j || in->holding[t][i].num_cards == 0) {
+                    continue;
+                }
+                in->places[in->num_places++] =
+                    (PairInput){ &in->holding[t][i], &piles[j], 0 };
+                int max = piles[i].num_cards < 13 ? piles[i].num_cards : 13;
+                in->moves[in->num_moves++] =
+                    (PairInput){ &piles[i], &piles[j], 1 + next_random(&random) % max };
+            }
+        }
+
+        for (int i = 0; i < NUM_TABLES * DECK_SIZE / 4; i++) {
+            int *mouse = in->mouse[in->num_mouse++];
+            mouse[0] = next_random(&random) % WINDOW_WIDTH;
+            mouse[1] = next_random(&random) % WINDOW_HEIGHT;
+            mouse[2] = t;
+        }
+    }
+}
+
+/*
+ * Each benchmark makes ops calls, going round its inputs, and returns a sum
+ * of what they returned, which keeps the compiler from dropping them and
+ * shows when a change makes a function answer differently.
+ */
+
+static long bench_shuffle(Inputs *in, long ops)
+{
+    Card deck[DECK_SIZE];
+    for (int i = 0; i < DECK_SIZE; i++) {
+        deck[i] = (Card){ i / 13 % 4, i % 13, FACEDOWN };
+    }
+    srand(1);
+    long sum = 0;
+    for (long op = 0; op < ops; op++) {
+        shuffle(deck, DECK_SIZE);
+        sum += deck[0].suit * 13 + deck[0].rank;
+    }
+    return sum;
+}
+
+static long bench_can_pick_up(Inputs *in, long ops)
+{
+    long sum = 0;
+    for (long op = 0, i = 0; op < ops; op++, i = i + 1 < in->num_cards ? i + 1 : 0) {
+        sum += can_pick_up(in->cards[i].pile, in->cards[i].idx);
+    }
+    return sum;
+}
+
+static long bench_can_place(Inputs *in, long ops)
+{
+    long sum = 0;
+    for (long op = 0, i = 0; op < ops; op++, i = i + 1 < in->num_places ? i + 1 : 0) {
+        sum += can_place(in->places[i].src, in->places[i].dst);
+    }
+    return sum;
+}
+
+/* A completed run is put back, so every pass sees the same piles */
+static long bench_check_complete(Inputs *in, long ops)
+{
+    long sum = 0;
+    for (long op = 0, i = 0; op < ops; op++, i = i + 1 < in->num_complete ? i + 1 : 0) {
+        Pile *pile = in->complete[i];
+        if (check_complete(pile, &in->goal)) {
+            move_pile(&in->goal, pile, 0);
+            sum++;
+        }
+    }
+    return sum;
+}
+
+/* Cards moved are moved back by the next call, and both calls count */
+static long bench_move_pile(Inputs *in, long ops)
+{
+    long sum = 0;
+    for (long op = 0, i = 0; op < ops; op += 2, i = i + 1 < in->num_moves ? i + 1 : 0) {
+        PairInput *move = &in->moves[i];
+        move_pile(move->src, move->dst, move->src->num_cards - move->count);
+        move_pile(move->dst, move->src, move->dst->num_cards - move->count);
+        sum += move->src->num_cards;
+    }
+    return sum;
+}
+
+static long bench_get_card_y(Inputs *in, long ops)
+{
+    long sum = 0;
+    for (long op = 0, i = 0; op < ops; op++, i = i + 1 < in->num_cards ? i + 1 : 0) {
+        sum += get_card_y(&in->graphics, in->cards[i].pile, &in->rects[0], in->cards[i].idx);
+    }
+    return sum;
+}
+
+static long bench_get_mouse_target(Inputs *in, long ops)
+{
+    long sum = 0;
+    for (long op = 0, i = 0; op < ops; op++, i = i + 1 < in->num_mouse ? i + 1 : 0) {
+        in->graphics.mouse_x = in->mouse[i][0];
+        in->graphics.mouse_y = in->mouse[i][1];
+        MouseTarget target = get_mouse_target(
+                &in->graphics, in->tables[in->mouse[i][2]], in->rects, NUM_PILES);
+        sum += target.pile * DECK_SIZE + target.card;
+    }
+    return sum;
+}
+
+typedef struct {
+    const char *name;
+    long (*run)(Inputs *in, long ops);
+    /* Calls per run, enough for a run to take a millisecond or so */
+    long ops;
+} Benchmark;
+
+static const Benchmark BENCHMARKS[] = {
+    { "shuffle", bench_shuffle, 2000 },
+    { "can_pick_up", bench_can_pick_up, 1000000 },
+    { "can_place", bench_can_place, 1000000 },
+    { "check_complete", bench_check_complete, 100000 },
+    { "move_pile", bench_move_pile, 200000 },
+    { "get_card_y", bench_get_card_y, 1000000 },
+    { "get_mouse_target", bench_get_mouse_target, 20000 },
+};
+#define NUM_BENCHMARKS (int)(sizeof(BENCHMARKS) / sizeof(BENCHMARKS[0]))
+
+typedef struct {
+    double median;
+    double mad;
+    long checksum;
+} Timing;
+
+static int compare_doubles(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+/* Sorts the values in place */
+static double median(double values[], int n)
+{
+    qsort(values, n, sizeof(double), compare_doubles);
+    return n % 2 ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2;
+}
+
+/*
+ * The median and its median absolute deviation, rather than the mean and
+ * standard deviation, so that a run the scheduler interrupted doesn't count
+ * for more than any other.
+ */
+static Timing time_benchmark(Inputs *in, const Benchmark *bench, int num_runs, int num_warmup)
+{
+    Timing timing = {0};
+    double *ns = malloc(num_runs * sizeof(double));
+    for (int i = -num_warmup; i < num_runs; i++) {
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        long checksum = bench->run(in, bench->ops);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        if (i >= 0) {
+            ns[i] = ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec))
+                / bench->ops;
+            timing.checksum = checksum;
+        }
+    }
+    timing.median = median(ns, num_runs);
+    for (int i = 0; i < num_runs; i++) {
+        ns[i] = ns[i] > timing.median ? ns[i] - timing.median : timing.median - ns[i];
+    }
+    timing.mad = median(ns, num_runs);
+    free(ns);
+    return timing;
+}
+
+int main(int argc, char **argv)
+{
+    int num_runs = 21;
+    int num_warmup = 3;
+    bool json = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--runs") == 0 && i + 1 < argc) {
+            num_runs = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) {
+            num_warmup = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--json") == 0) {
+            json = true;
+        } else {
+            usage();
+            return 1;
+        }
+    }
+    if (num_runs < 1 || num_warmup < 0) {
+        usage();
+        return 1;
+    }
+
+    Inputs *in = malloc(sizeof(Inputs));
+    make_inputs(in);
+    if (json) {
+        printf("{\n  \"compiler\": \"%s\",\n  \"cflags\": \"%s\",\n", __VERSION__, BENCH_CFLAGS);
+        printf("  \"runs\": %d,\n  \"warmup\": %d,\n  \"benchmarks\": [\n",
+                num_runs, num_warmup);
+    } else {
+        printf("%-18s %12s %10s %10s\n", "function", "ns/op", "mad", "ops/run");
+    }
+    for (int i = 0; i < NUM_BENCHMARKS; i++) {
+        const Benchmark *bench = &BENCHMARKS[i];
+        Timing timing = time_benchmark(in, bench, num_runs, num_warmup);
+        if (json) {
+            printf("    { \"name\": \"%s\", \"ops\": %ld, \"median_ns\": %.2f, "
+                    "\"mad_ns\": %.2f, \"checksum\": %ld }%s\n", bench->name, bench->ops,
+                    timing.median, timing.mad, timing.checksum,
+                    i + 1 < NUM_BENCHMARKS ? "," : "");
+        } else {
+            printf("%-18s %12.2f %10.2f %10ld\n", bench->name, timing.median, timing.mad,
+                    bench->ops);
+        }
+    }
+    if (json) {
+        printf("  ]\n}\n");
+    }
+    free(in);
+    return 0;
+}
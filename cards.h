@@ -1,6 +1,8 @@
 #ifndef CARDS_H
 #define CARDS_H
 
+#include <stddef.h>
+
 typedef enum { FACEDOWN, FACEUP } Orientation;
 
 typedef struct {
@@ -9,6 +11,13 @@ typedef struct {
     Orientation orientation;
 } Card;
 
+/* A pile of cards */
+typedef struct {
+    /* There will never be more than 2 decks of cards in a pile */
+    Card cards[104];
+    int num_cards;
+} Pile;
+
 void shuffle(Card *deck, size_t num_cards);
 
 #endif
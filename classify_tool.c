@@ -0,0 +1,234 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "solver.h"
+
+/*
+ * Ranks Spider deals by how hard they are, without SDL.
+ */
+
+static void usage()
+{
+    printf("usage: spider-classify [--suits 1|2|4] [--width W] [--max-nodes N] [--threads N]\n");
+    printf("                       [--pool easy|medium|hard] --range FIRST-LAST\n");
+    printf("Measures every deal in the range and prints them ranked from easiest to hardest:\n");
+    printf("how far a beam search W wide gets with N nodes per search, then the deal's layout.\n");
+    printf("The easiest third of the won deals are easy, the next medium and the rest hard;\n");
+    printf("lost deals get no class. --pool prints only the seeds of one class, for\n");
+    printf("./spider --seeds FILE, so it never hands out a deal the search couldn't win.\n");
+}
+
+typedef struct {
+    uint32_t seed;
+    /* Face-up cards that could go on the next higher face-up card */
+    int runs;
+    /* Cards under kings, which stay there until a king has an empty pile */
+    int key_depth;
+    /* Piles each suit is spread over, summed over the suits */
+    int spread;
+    bool won;
+    int completed;
+    long nodes;
+} DealFeatures;
+
+static void measure_layout(Position *pos, DealFeatures *features)
+{
+    uint8_t tops[NUM_PILES];
+    int num_tops = 0;
+    int suit_piles[4][NUM_PILES] = {{0}};
+    for (int i = 0; i < NUM_PILES; i++) {
+        uint8_t *cards = pile_cards(pos, i);
+        int len = pos->num_cards[i];
+        for (int j = 0; j < len; j++) {
+            if (cards[j] % 13 == 12) {
+                features->key_depth += j;
+            }
+            suit_piles[cards[j] / 13][i] = 1;
+        }
+        if (len > 0) {
+            tops[num_tops++] = cards[len - 1];
+        }
+    }
+    for (int i = 0; i < num_tops; i++) {
+        for (int j = 0; j < num_tops; j++) {
+            if (tops[j] % 13 == tops[i] % 13 + 1) {
+                features->runs++;
+                break;
+            }
+        }
+    }
+    for (int suit = 0; suit < 4; suit++) {
+        for (int i = 0; i < NUM_PILES; i++) {
+            features->spread += suit_piles[suit][i];
+        }
+    }
+}
+
+/*
+ * Plays the deal out as spider-solve does, taking the best line of each
+ * search while it improves on the position. Searches are limited by nodes
+ * rather than time, so the result doesn't depend on how busy the machine is.
+ */
+static void measure_effort(Position *pos, BeamOptions options, DealFeatures *features)
+{
+    while (pos->num_completed < NUM_COMPLETE) {
+        BeamResult result = beam_search(pos, options);
+        features->nodes += result.nodes;
+        if (!result.found) {
+            break;
+        }
+        for (int i = 0; i < result.num_moves; i++) {
+            apply_move(pos, result.moves[i]);
+        }
+    }
+    features->won = pos->num_completed == NUM_COMPLETE;
+    features->completed = pos->num_completed;
+}
+
+/*
+ * Deals are handed out one at a time from a shared counter, and each worker
+ * writes straight into the deal's own slot, so nothing waits on a lock.
+ */
+typedef struct {
+    BeamOptions options;
+    int num_suits;
+    uint32_t first;
+    uint32_t num_deals;
+    atomic_uint next;
+    DealFeatures *features;
+} Classifier;
+
+static void *classify_worker(void *arg)
+{
+    Classifier *classifier = arg;
+    uint32_t i;
+    while ((i = atomic_fetch_add(&classifier->next, 1)) < classifier->num_deals) {
+        DealFeatures *features = &classifier->features[i];
+        memset(features, 0, sizeof(*features));
+        features->seed = classifier->first + i;
+        Position pos;
+        deal_position(&pos, features->seed, classifier->num_suits);
+        measure_layout(&pos, features);
+        measure_effort(&pos, classifier->options, features);
+    }
+    return NULL;
+}
+
+/*
+ * Won deals first, by how much searching they took, then the rest by how
+ * many suits they got to. The seed settles the rest, so the table is the
+ * same however many threads built it.
+ */
+static int compare_deals(const void *a, const void *b)
+{
+    const DealFeatures *x = a;
+    const DealFeatures *y = b;
+    if (x->won != y->won) {
+        return x->won ? -1 : 1;
+    }
+    if (!x->won && x->completed != y->completed) {
+        return y->completed - x->completed;
+    }
+    if (x->nodes != y->nodes) {
+        return x->nodes < y->nodes ? -1 : 1;
+    }
+    if (x->key_depth != y->key_depth) {
+        return x->key_depth - y->key_depth;
+    }
+    return x->seed < y->seed ? -1 : x->seed > y->seed;
+}
+
+static const char *CLASS_NAMES[] = { "easy", "medium", "hard" };
+
+int main(int argc, char **argv)
+{
+    BeamOptions options = { 64, BEAM_MAX_DEPTH, 200000, 0, PLAY_WEIGHTS, NULL };
+    int suits = 4;
+    long first = -1, last = -1;
+    int num_threads = sysconf(_SC_NPROCESSORS_ONLN);
+    int pool = -1;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--suits") == 0 && i + 1 < argc) {
+            suits = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--width") == 0 && i + 1 < argc) {
+            options.width = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--max-nodes") == 0 && i + 1 < argc) {
+            options.max_nodes = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            num_threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--pool") == 0 && i + 1 < argc) {
+            i++;
+            for (int c = 0; c < 3; c++) {
+                if (strcmp(argv[i], CLASS_NAMES[c]) == 0) {
+                    pool = c;
+                }
+            }
+            if (pool < 0) {
+                usage();
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--range") == 0 && i + 1 < argc) {
+            if (sscanf(argv[++i], "%ld-%ld", &first, &last) != 2) {
+                usage();
+                return 1;
+            }
+        } else {
+            usage();
+            return 1;
+        }
+    }
+    if (first < 0 || last < first || last > UINT32_MAX || num_threads < 1
+            || options.max_nodes < 1 || (suits != 1 && suits != 2 && suits != 4)) {
+        usage();
+        return 1;
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    Classifier classifier = { options, suits, first, last - first + 1 };
+    atomic_init(&classifier.next, 0);
+    classifier.features = malloc(classifier.num_deals * sizeof(DealFeatures));
+    pthread_t *threads = malloc(num_threads * sizeof(pthread_t));
+    for (int i = 0; i < num_threads; i++) {
+        pthread_create(&threads[i], NULL, classify_worker, &classifier);
+    }
+    for (int i = 0; i < num_threads; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    DealFeatures *ranked = classifier.features;
+    uint32_t num_deals = classifier.num_deals;
+    qsort(ranked, num_deals, sizeof(DealFeatures), compare_deals);
+    /* Won deals sort first, and only they are graded */
+    long won = 0;
+    while (won < num_deals && ranked[won].won) {
+        won++;
+    }
+    if (pool < 0) {
+        printf("rank seed class result completed nodes runs key_depth spread\n");
+    }
+    for (long i = 0; i < num_deals; i++) {
+        DealFeatures *f = &ranked[i];
+        int class = i < won ? i * 3 / won : -1;
+        if (pool < 0) {
+            printf("%ld %u %s %s %d %ld %d %d %d\n", i + 1, f->seed,
+                    class >= 0 ? CLASS_NAMES[class] : "-",
+                    f->won ? "won" : "lost", f->completed, f->nodes, f->runs, f->key_depth,
+                    f->spread);
+        } else if (class == pool) {
+            printf("%u\n", f->seed);
+        }
+    }
+    fprintf(stderr, "%u deals, %ld won, in %.1f s on %d threads\n", num_deals, won, seconds,
+            num_threads);
+    free(ranked);
+    return 0;
+}
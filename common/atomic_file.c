@@ -0,0 +1,56 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "atomic_file.h"
+
+/*
+ * Writes the data next to path, syncs it to disk and renames it into place,
+ * so that a crash part way through leaves whatever was there before whole.
+ */
+bool atomic_file_write(const char *path, const void *data, size_t size)
+{
+    char tmp[4096];
+    if (snprintf(tmp, sizeof(tmp), "%s.tmp", path) >= (int)sizeof(tmp)) {
+        return false;
+    }
+    FILE *f = fopen(tmp, "wb");
+    if (!f) {
+        return false;
+    }
+    bool ok = fwrite(data, 1, size, f) == size
+        && fflush(f) == 0 && fsync(fileno(f)) == 0;
+    ok = fclose(f) == 0 && ok;
+    if (!ok || rename(tmp, path) != 0) {
+        remove(tmp);
+        return false;
+    }
+    return true;
+}
+
+/*
+ * Maps the file and copies it out, if it is exactly size bytes long.
+ */
+bool mapped_file_read(const char *path, void *data, size_t size)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size != size) {
+        close(fd);
+        return false;
+    }
+    void *mapped = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        return false;
+    }
+    memcpy(data, mapped, size);
+    munmap(mapped, size);
+    return true;
+}
@@ -0,0 +1,16 @@
+#ifndef ATOMIC_FILE_H
+#define ATOMIC_FILE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Whole-file writes that never leave a file half written, and reads of
+ * fixed-size files through a single mmap. Both games save their snapshots
+ * with these, and FreeCell its deal database.
+ */
+
+bool atomic_file_write(const char *path, const void *data, size_t size);
+bool mapped_file_read(const char *path, void *data, size_t size);
+
+#endif
@@ -0,0 +1,226 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "fuzz_driver.h"
+
+/* Longer lines are only written to the replay file */
+#define MAX_PRINTED_MOVES 50
+
+typedef struct {
+    const FuzzRules *rules;
+    int max_moves;
+    uint32_t first;
+    uint32_t num_deals;
+    const char *out_path;
+    atomic_uint next;
+    atomic_long moves;
+    atomic_long failures;
+    pthread_mutex_t report_lock;
+} Fuzzer;
+
+static void usage(const FuzzRules *rules)
+{
+    printf("usage: %s%s [--threads N] [--moves N] [--out FILE]\n", rules->name, rules->options);
+    printf("       %*s --range FIRST-LAST\n", (int)strlen(rules->name), "");
+    printf("Plays up to N random moves from each deal in the range, checking the game after\n");
+    printf("every one. A failing game is cut down to as few moves as still fail and printed,\n");
+    printf("and with --out added to FILE as a replay.\n");
+}
+
+/* Seeded per deal, so a deal's random game is the same on every run */
+uint32_t fuzz_random(uint64_t *state)
+{
+    *state = *state * 6364136223846793005ull + 1442695040888963407ull;
+    return *state >> 33;
+}
+
+static void *move_at(const FuzzRules *rules, void *line, int i)
+{
+    return (char *)line + i * rules->move_size;
+}
+
+/*
+ * Plays a line of moves from the deal. Returns the index of the move after
+ * which something went wrong, with *error saying what, or -1 if nothing did
+ * or a move wasn't legal, which can happen to a line being cut down.
+ */
+static int first_failure(
+        const FuzzRules *rules,
+        void *game,
+        uint32_t deal,
+        void *line,
+        int len,
+        const char **error)
+{
+    rules->start(game, deal);
+    for (int i = 0; i < len; i++) {
+        bool illegal = false;
+        const char *e = rules->play(game, move_at(rules, line, i), &illegal);
+        if (illegal) {
+            return -1;
+        }
+        if (e) {
+            if (error) {
+                *error = e;
+            }
+            return i;
+        }
+    }
+    return -1;
+}
+
+/*
+ * Cuts a failing line down, first to the failing move and then by dropping
+ * ever shorter runs of moves for as long as what is left still fails.
+ * Returns the new length.
+ */
+static int shrink(const FuzzRules *rules, void *game, uint32_t deal, void *line, int len)
+{
+    size_t size = rules->move_size;
+    char *trial = malloc(len * size);
+    for (int chunk = len / 2; chunk >= 1; chunk /= 2) {
+        for (int start = 0; start + chunk <= len;) {
+            memcpy(trial, line, start * size);
+            memcpy(trial + start * size, move_at(rules, line, start + chunk),
+                    (len - start - chunk) * size);
+            int at = first_failure(rules, game, deal, trial, len - chunk, NULL);
+            if (at >= 0) {
+                len = at + 1;
+                memcpy(line, trial, len * size);
+            } else {
+                start += chunk;
+            }
+        }
+    }
+    free(trial);
+    return len;
+}
+
+static void report(Fuzzer *fuzzer, uint32_t deal, const char *error, int at, void *line, int len)
+{
+    const FuzzRules *rules = fuzzer->rules;
+    pthread_mutex_lock(&fuzzer->report_lock);
+    printf("%s %u: %s after move %d, down to %d moves", rules->deal_name, deal, error, at + 1, len);
+    Replay replay = {0};
+    replay_start(&replay, rules->variant, deal);
+    if (rules->start_replay) {
+        rules->start_replay(&replay);
+    }
+    bool print = len <= MAX_PRINTED_MOVES;
+    if (print) {
+        printf(":");
+    }
+    for (int i = 0; i < len; i++) {
+        if (print) {
+            char text[16];
+            rules->format(move_at(rules, line, i), text);
+            printf(" %s", text);
+        }
+        rules->record(&replay, move_at(rules, line, i));
+    }
+    printf("\n");
+    if (fuzzer->out_path && !replay_append(&replay, fuzzer->out_path)) {
+        fprintf(stderr, "couldn't write %s\n", fuzzer->out_path);
+    }
+    replay_free(&replay);
+    pthread_mutex_unlock(&fuzzer->report_lock);
+}
+
+static void *fuzz_worker(void *arg)
+{
+    Fuzzer *fuzzer = arg;
+    const FuzzRules *rules = fuzzer->rules;
+    void *line = malloc((fuzzer->max_moves + rules->extra_moves) * rules->move_size);
+    void *game = malloc(rules->game_size);
+    uint32_t i;
+    while ((i = atomic_fetch_add(&fuzzer->next, 1)) < fuzzer->num_deals) {
+        uint32_t deal = fuzzer->first + i;
+        uint64_t random = deal;
+        rules->start(game, deal);
+        int len = 0;
+        const char *error = NULL;
+        while (len < fuzzer->max_moves && !error) {
+            int played = rules->play_random(game, &random, move_at(rules, line, len), &error);
+            if (played == 0) {
+                break;
+            }
+            len += played;
+        }
+        atomic_fetch_add(&fuzzer->moves, len);
+        if (error) {
+            atomic_fetch_add(&fuzzer->failures, 1);
+            int at = len - 1;
+            len = shrink(rules, game, deal, line, len);
+            first_failure(rules, game, deal, line, len, &error);
+            report(fuzzer, deal, error, at, line, len);
+        }
+    }
+    free(game);
+    free(line);
+    return NULL;
+}
+
+/*
+ * The whole of a game's fuzz tool once given its rules. Returns 2 if any
+ * game failed a check.
+ */
+int fuzz_main(const FuzzRules *rules, int argc, char **argv)
+{
+    int max_moves = 1000;
+    int num_threads = sysconf(_SC_NPROCESSORS_ONLN);
+    long first = -1, last = -1;
+    const char *out_path = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            num_threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--moves") == 0 && i + 1 < argc) {
+            max_moves = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            out_path = argv[++i];
+        } else if (strcmp(argv[i], "--range") == 0 && i + 1 < argc) {
+            if (sscanf(argv[++i], "%ld-%ld", &first, &last) != 2) {
+                usage(rules);
+                return 1;
+            }
+        } else if (rules->option && i + 1 < argc && rules->option(argv[i], argv[i + 1])) {
+            i++;
+        } else {
+            usage(rules);
+            return 1;
+        }
+    }
+    if (first < 0 || last < first || last > UINT32_MAX || num_threads < 1 || max_moves < 1) {
+        usage(rules);
+        return 1;
+    }
+
+    Fuzzer fuzzer = { rules, max_moves, first, last - first + 1, out_path };
+    atomic_init(&fuzzer.next, 0);
+    atomic_init(&fuzzer.moves, 0);
+    atomic_init(&fuzzer.failures, 0);
+    pthread_mutex_init(&fuzzer.report_lock, NULL);
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pthread_t *threads = malloc(num_threads * sizeof(pthread_t));
+    for (int i = 0; i < num_threads; i++) {
+        pthread_create(&threads[i], NULL, fuzz_worker, &fuzzer);
+    }
+    for (int i = 0; i < num_threads; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    pthread_mutex_destroy(&fuzzer.report_lock);
+
+    double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    long moves = atomic_load(&fuzzer.moves);
+    long failures = atomic_load(&fuzzer.failures);
+    fprintf(stderr, "%u games, %ld moves checked in %.1f s on %d threads, %.0f moves/s, %ld failed\n",
+            fuzzer.num_deals, moves, seconds, num_threads, moves / seconds, failures);
+    return failures > 0 ? 2 : 0;
+}
@@ -0,0 +1,58 @@
+#ifndef FUZZ_DRIVER_H
+#define FUZZ_DRIVER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "replay_format.h"
+
+/*
+ * The random-play fuzzer both games build their fuzz tool on. The driver
+ * hands out deals to threads, plays a seeded random game from each, cuts a
+ * failing game down to as few moves as still fail and reports it. What a
+ * game and a move are, which moves to try and what to check after each is
+ * left to the game, through a FuzzRules. Games and moves are opaque to the
+ * driver, which only copies them by size.
+ */
+
+typedef struct {
+    const char *name;
+    /* Usage for the game's own options, such as " [--suits 1|2|4]", or "" */
+    const char *options;
+    /* What a game is started from in messages, "deal" or "seed" */
+    const char *deal_name;
+    ReplayVariant variant;
+    size_t game_size;
+    size_t move_size;
+    /* How many moves past --moves one call to play_random can add */
+    int extra_moves;
+
+    /*
+     * Takes one of the game's options with its value, returning false if
+     * it isn't one or the value is bad. May be NULL.
+     */
+    bool (*option)(const char *name, const char *value);
+    void (*start)(void *game, uint32_t deal);
+    /*
+     * Plays from the game at random, adding the moves made to moves. Returns
+     * how many it added, 0 if there was nothing left to play, with *error
+     * set if a check failed after the last of them.
+     */
+    int (*play_random)(void *game, uint64_t *random, void *moves, const char **error);
+    /*
+     * Checks the move and makes it, returning what went wrong if anything
+     * did. A move the game doesn't allow, and rightly, sets *illegal and
+     * isn't made.
+     */
+    const char *(*play)(void *game, const void *move, bool *illegal);
+    void (*format)(const void *move, char text[16]);
+    /* Fills in what the header needs past the variant and deal. May be NULL. */
+    void (*start_replay)(Replay *replay);
+    void (*record)(Replay *replay, const void *move);
+} FuzzRules;
+
+uint32_t fuzz_random(uint64_t *state);
+int fuzz_main(const FuzzRules *rules, int argc, char **argv);
+
+#endif
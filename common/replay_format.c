@@ -0,0 +1,96 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "replay_format.h"
+
+void replay_start(Replay *replay, ReplayVariant variant, uint32_t seed)
+{
+    replay->header = (ReplayHeader){ REPLAY_MAGIC, REPLAY_VERSION, variant, 0, 0, seed, 0, 0 };
+}
+
+void replay_free(Replay *replay)
+{
+    free(replay->moves);
+    memset(replay, 0, sizeof(*replay));
+}
+
+/*
+ * Adds a move, packed by the game into fewer than 7 * REPLAY_MAX_MOVE_BYTES
+ * bits.
+ */
+void replay_record_value(Replay *replay, uint32_t value)
+{
+    if (replay->header.size + REPLAY_MAX_MOVE_BYTES > replay->capacity) {
+        replay->capacity = replay->capacity ? replay->capacity * 2 : 256;
+        replay->moves = realloc(replay->moves, replay->capacity);
+    }
+    uint8_t *out = replay->moves + replay->header.size;
+    while (value >= 0x80) {
+        *out++ = value | 0x80;
+        value >>= 7;
+    }
+    *out++ = value;
+    replay->header.size = out - replay->moves;
+    replay->header.num_moves++;
+}
+
+/*
+ * Adds the game to the end of the file, creating it if need be.
+ */
+bool replay_append(Replay *replay, const char *path)
+{
+    FILE *f = fopen(path, "ab");
+    if (!f) {
+        return false;
+    }
+    bool ok = fwrite(&replay->header, sizeof(ReplayHeader), 1, f) == 1
+        && fwrite(replay->moves, 1, replay->header.size, f) == replay->header.size;
+    return fclose(f) == 0 && ok;
+}
+
+/*
+ * Reads the next game from the file into replay, reusing its buffer.
+ * Returns 1 on success, 0 at the end of the file and -1 if what follows
+ * isn't a replay.
+ */
+int replay_read(Replay *replay, FILE *file)
+{
+    ReplayHeader header;
+    size_t read = fread(&header, 1, sizeof(header), file);
+    if (read == 0 && feof(file)) {
+        return 0;
+    }
+    if (read != sizeof(header) || header.magic != REPLAY_MAGIC
+            || header.version != REPLAY_VERSION
+            || header.size > (size_t)header.num_moves * REPLAY_MAX_MOVE_BYTES) {
+        return -1;
+    }
+    if (header.size > replay->capacity) {
+        replay->capacity = header.size;
+        replay->moves = realloc(replay->moves, replay->capacity);
+    }
+    if (fread(replay->moves, 1, header.size, file) != header.size) {
+        return -1;
+    }
+    replay->header = header;
+    return 1;
+}
+
+/*
+ * Decodes the move at *pos and steps past it. False once the moves run out
+ * or if the last one is cut short.
+ */
+bool replay_next_value(Replay *replay, size_t *pos, uint32_t *value)
+{
+    uint32_t decoded = 0;
+    for (int shift = 0; *pos < replay->header.size && shift < 7 * REPLAY_MAX_MOVE_BYTES;
+            shift += 7) {
+        uint8_t byte = replay->moves[(*pos)++];
+        decoded |= (uint32_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            *value = decoded;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,51 @@
+#ifndef REPLAY_FORMAT_H
+#define REPLAY_FORMAT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * The replay format both games record in, built by both Makefiles. A
+ * recorded game is the deal it started from and every move made in it,
+ * enough to play it back exactly. A file holds any number of games back to
+ * back, each a ReplayHeader followed by its moves. A move is a varint, 7
+ * bits a byte low bits first with the high bit set on all but the last
+ * byte, of a value each game packs its own moves into (see replay.h in each
+ * game). Headers are in the byte order of the machine that wrote them.
+ */
+
+#define REPLAY_MAGIC 0x4c504552 /* "REPL" */
+#define REPLAY_VERSION 1
+
+/* Longest varint a move can take, so moves pack into 21 bits */
+#define REPLAY_MAX_MOVE_BYTES 3
+
+typedef enum { REPLAY_FREECELL, REPLAY_SPIDER } ReplayVariant;
+
+typedef struct {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t variant; /* A ReplayVariant */
+    uint8_t suits; /* Spider's number of suits, 0 for 4 or FreeCell */
+    uint8_t unused;
+    uint32_t seed; /* Spider's seed, or FreeCell's Microsoft deal number */
+    uint32_t num_moves;
+    uint32_t size; /* Bytes of moves that follow */
+} ReplayHeader;
+
+typedef struct {
+    ReplayHeader header;
+    uint8_t *moves;
+    size_t capacity;
+} Replay;
+
+void replay_start(Replay *replay, ReplayVariant variant, uint32_t seed);
+void replay_free(Replay *replay);
+void replay_record_value(Replay *replay, uint32_t value);
+bool replay_append(Replay *replay, const char *path);
+int replay_read(Replay *replay, FILE *file);
+bool replay_next_value(Replay *replay, size_t *pos, uint32_t *value);
+
+#endif
@@ -0,0 +1,254 @@
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "dealdb.h"
+#include "rules.h"
+#include "solver.h"
+#include "timer.h"
+
+static void usage() {
+    printf("usage: freecell-classify [--mode dfs|best|optimal] [--max-nodes N] [--tt-mb MB]\n");
+    printf("                         [--search-mb MB] [--threads N] [--db FILE] --range FIRST-LAST\n");
+    printf("Measures every deal in the range and prints them ranked from easiest to hardest:\n");
+    printf("the solver's effort at a fixed node budget, then the deal's layout. The easiest\n");
+    printf("third of the solved deals are easy, the next medium and the rest hard. --db\n");
+    printf("writes them as a deal database for ./freecell --db FILE --difficulty D.\n");
+}
+
+// FEATURES
+// ----------------------------------------
+
+typedef struct {
+    uint32_t deal;
+    // Cards already on the next higher card of the other colour, ready to
+    // move together
+    int runs;
+    // Cards on top of the aces and twos, which have to be cleared off them
+    int key_depth;
+    // Columns each suit's ace to five are spread over, summed over the suits
+    int spread;
+    SolveStatus status;
+    int moves;
+    long nodes;
+    Difficulty difficulty;
+} DealFeatures;
+
+static void measure_layout(GameState *game, DealFeatures *features) {
+    for (int column = 0; column < NUM_COLUMNS; column++) {
+        Card *cards = column_cards(game, column);
+        int len = game->column_len[column];
+        for (int i = 0; i < len; i++) {
+            if (i > 0 && cards[i].rank == cards[i - 1].rank - 1
+                    && card_color(cards[i]) != card_color(cards[i - 1])) {
+                features->runs++;
+            }
+            if (cards[i].rank <= 2) {
+                features->key_depth += len - 1 - i;
+            }
+        }
+    }
+    for (int suit = SUIT_SPADE; suit <= SUIT_DIAMOND; suit++) {
+        for (int column = 0; column < NUM_COLUMNS; column++) {
+            Card *cards = column_cards(game, column);
+            for (int i = 0; i < game->column_len[column]; i++) {
+                if (cards[i].suit == suit && cards[i].rank <= 5) {
+                    features->spread++;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+// Deals are handed out one at a time from a shared counter, and each worker
+// writes straight into the deal's own slot, so nothing waits on a lock.
+typedef struct {
+    SolverOptions options;
+    uint32_t first;
+    uint32_t num_deals;
+    atomic_uint next;
+    DealFeatures *features;
+} Classifier;
+
+static void *classify_worker(void *arg) {
+    Classifier *classifier = arg;
+    Solver *solver = solver_new();
+    uint32_t i;
+    while ((i = atomic_fetch_add(&classifier->next, 1)) < classifier->num_deals) {
+        DealFeatures *features = &classifier->features[i];
+        memset(features, 0, sizeof(*features));
+        features->deal = classifier->first + i;
+        GameState game;
+        deal_from_number(&game, features->deal);
+        measure_layout(&game, features);
+        Solution solution = solver_solve(solver, &game, classifier->options);
+        features->status = solution.status;
+        features->moves = solution.num_moves;
+        features->nodes = solution.nodes;
+        free_solution(&solution);
+    }
+    solver_free(solver);
+    return NULL;
+}
+
+// RANKING
+// ----------------------------------------
+
+// Solved deals first, by how much searching they took, then by how buried
+// their low cards are. The deal number settles the rest, so the table is the
+// same however many threads built it.
+static int compare_deals(const void *a, const void *b) {
+    const DealFeatures *x = a;
+    const DealFeatures *y = b;
+    bool x_solved = x->status == SOLVE_SOLVED;
+    bool y_solved = y->status == SOLVE_SOLVED;
+    if (x_solved != y_solved) {
+        return x_solved ? -1 : 1;
+    }
+    if (x->nodes != y->nodes) {
+        return x->nodes < y->nodes ? -1 : 1;
+    }
+    if (x->key_depth != y->key_depth) {
+        return x->key_depth - y->key_depth;
+    }
+    return x->deal < y->deal ? -1 : x->deal > y->deal;
+}
+
+// How closely a layout feature follows the solver's effort over the solved
+// deals, as a correlation with the log of the nodes, from -1 to 1
+static double correlation(DealFeatures *features, long n, int (*feature)(DealFeatures *)) {
+    double sx = 0, sy = 0, sxx = 0, syy = 0, sxy = 0;
+    for (long i = 0; i < n; i++) {
+        double x = feature(&features[i]);
+        double y = log(features[i].nodes + 1.0);
+        sx += x;
+        sy += y;
+        sxx += x * x;
+        syy += y * y;
+        sxy += x * y;
+    }
+    double cov = sxy - sx * sy / n;
+    double var = (sxx - sx * sx / n) * (syy - sy * sy / n);
+    return var > 0 ? cov / sqrt(var) : 0;
+}
+
+static int feature_runs(DealFeatures *features) {
+    return features->runs;
+}
+
+static int feature_key_depth(DealFeatures *features) {
+    return features->key_depth;
+}
+
+static int feature_spread(DealFeatures *features) {
+    return features->spread;
+}
+
+// MAIN
+// ----------------------------------------
+
+int main(int argc, char **argv) {
+    SolverOptions options = { SEARCH_BEST_FIRST, 100000, DEFAULT_TT_MB };
+    long first = -1, last = -1;
+    int num_threads = sysconf(_SC_NPROCESSORS_ONLN);
+    const char *db_path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--mode") == 0 && i + 1 < argc) {
+            if (!parse_search_mode(argv[++i], &options.mode)) {
+                usage();
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--max-nodes") == 0 && i + 1 < argc) {
+            options.max_nodes = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--tt-mb") == 0 && i + 1 < argc) {
+            options.tt_mb = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--search-mb") == 0 && i + 1 < argc) {
+            options.search_mb = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            num_threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--db") == 0 && i + 1 < argc) {
+            db_path = argv[++i];
+        } else if (strcmp(argv[i], "--range") == 0 && i + 1 < argc) {
+            if (sscanf(argv[++i], "%ld-%ld", &first, &last) != 2) {
+                usage();
+                return 1;
+            }
+        } else {
+            usage();
+            return 1;
+        }
+    }
+    if (first < 0 || last < first || last > UINT32_MAX || num_threads < 1) {
+        usage();
+        return 1;
+    }
+
+    uint64_t t = get_performance_counter();
+    Classifier classifier = { options, first, last - first + 1 };
+    atomic_init(&classifier.next, 0);
+    classifier.features = malloc(classifier.num_deals * sizeof(DealFeatures));
+    pthread_t *threads = malloc(num_threads * sizeof(pthread_t));
+    for (int i = 0; i < num_threads; i++) {
+        pthread_create(&threads[i], NULL, classify_worker, &classifier);
+    }
+    for (int i = 0; i < num_threads; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+    float seconds = (get_performance_counter() - t) / (float)get_performance_frequency();
+
+    DealFeatures *ranked = classifier.features;
+    uint32_t num_deals = classifier.num_deals;
+    qsort(ranked, num_deals, sizeof(DealFeatures), compare_deals);
+    long solved = 0;
+    while (solved < num_deals && ranked[solved].status == SOLVE_SOLVED) {
+        solved++;
+    }
+    for (long i = 0; i < num_deals; i++) {
+        ranked[i].difficulty = i >= solved ? DIFFICULTY_ANY
+            : i < solved / 3 ? DIFFICULTY_EASY
+            : i < solved * 2 / 3 ? DIFFICULTY_MEDIUM : DIFFICULTY_HARD;
+    }
+
+    printf("rank deal class status moves nodes runs key_depth spread\n");
+    for (long i = 0; i < num_deals; i++) {
+        DealFeatures *f = &ranked[i];
+        printf("%ld %u %s %s %d %ld %d %d %d\n", i + 1, f->deal,
+                f->status == SOLVE_SOLVED ? difficulty_name(f->difficulty) : "-",
+                solve_status_name(f->status), f->moves, f->nodes, f->runs, f->key_depth,
+                f->spread);
+    }
+    fprintf(stderr, "%u deals, %ld solved, in %.1f s on %d threads\n", num_deals, solved, seconds,
+            num_threads);
+    if (solved > 1) {
+        fprintf(stderr, "correlation with log nodes: runs %.2f key_depth %.2f spread %.2f\n",
+                correlation(ranked, solved, feature_runs),
+                correlation(ranked, solved, feature_key_depth),
+                correlation(ranked, solved, feature_spread));
+    }
+
+    int status = 0;
+    if (db_path) {
+        DealRecord *records = calloc(num_deals, sizeof(DealRecord));
+        for (long i = 0; i < num_deals; i++) {
+            DealRecord *record = &records[ranked[i].deal - first];
+            record->status = ranked[i].status;
+            record->moves = ranked[i].moves;
+            record->nodes = ranked[i].nodes > UINT32_MAX ? UINT32_MAX : ranked[i].nodes;
+            record->difficulty = ranked[i].difficulty;
+        }
+        if (!dealdb_write(db_path, first, num_deals, records)) {
+            fprintf(stderr, "couldn't write deal database %s\n", db_path);
+            status = 1;
+        }
+        free(records);
+    }
+    free(ranked);
+    return status;
+}
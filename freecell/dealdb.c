@@ -0,0 +1,129 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../common/atomic_file.h"
+#include "dealdb.h"
+#include "solver.h"
+
+// Maps the file read-only and checks that its header matches its size
+bool dealdb_open(DealDb *db, const char *path) {
+    memset(db, 0, sizeof(*db));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(DealDbHeader)) {
+        close(fd);
+        return false;
+    }
+    void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+
+    const DealDbHeader *header = data;
+    size_t expected = sizeof(DealDbHeader) + (size_t)header->num_deals * sizeof(DealRecord);
+    if (header->magic != DEALDB_MAGIC || header->version != DEALDB_VERSION
+            || (size_t)st.st_size != expected) {
+        munmap(data, st.st_size);
+        return false;
+    }
+    db->header = header;
+    db->records = (const DealRecord *)(header + 1);
+    db->size = st.st_size;
+    return true;
+}
+
+void dealdb_close(DealDb *db) {
+    if (db->header) {
+        munmap((void *)db->header, db->size);
+    }
+    memset(db, 0, sizeof(*db));
+}
+
+// Writes the database next to path and renames it into place, so that a
+// build cut short never leaves a truncated file where the game maps it
+bool dealdb_write(const char *path, uint32_t first_deal, uint32_t num_deals, DealRecord records[]) {
+    size_t size = sizeof(DealDbHeader) + (size_t)num_deals * sizeof(DealRecord);
+    unsigned char *data = malloc(size);
+    if (!data) {
+        return false;
+    }
+    DealDbHeader header = { DEALDB_MAGIC, DEALDB_VERSION, first_deal, num_deals };
+    memcpy(data, &header, sizeof(header));
+    memcpy(data + sizeof(header), records, (size_t)num_deals * sizeof(DealRecord));
+    bool ok = atomic_file_write(path, data, size);
+    free(data);
+    return ok;
+}
+
+// The record for a deal, or NULL if it is outside the database
+const DealRecord *dealdb_lookup(DealDb *db, uint32_t deal) {
+    if (!db->header || deal < db->header->first_deal
+            || deal - db->header->first_deal >= db->header->num_deals) {
+        return NULL;
+    }
+    return &db->records[deal - db->header->first_deal];
+}
+
+// A random solved deal of the given difficulty, or -1 if there are none.
+// Starts at a random record and takes the first match from there on.
+long dealdb_pick(DealDb *db, Difficulty difficulty) {
+    if (!db->header || db->header->num_deals == 0) {
+        return -1;
+    }
+    uint32_t n = db->header->num_deals;
+    uint32_t start = ((uint32_t)rand() * (RAND_MAX + 1u) + rand()) % n;
+    for (uint32_t i = 0; i < n; i++) {
+        const DealRecord *record = &db->records[(start + i) % n];
+        if (record->status != SOLVE_SOLVED) {
+            continue;
+        }
+        if (difficulty == DIFFICULTY_ANY || deal_difficulty(record) == difficulty) {
+            return db->header->first_deal + (start + i) % n;
+        }
+    }
+    return -1;
+}
+
+// How hard a solved deal is, as ranked when the database was built if it
+// was, and otherwise going by how much searching the solver needed.
+// DIFFICULTY_ANY for deals that weren't solved.
+Difficulty deal_difficulty(const DealRecord *record) {
+    if (record->status != SOLVE_SOLVED) {
+        return DIFFICULTY_ANY;
+    }
+    if (record->difficulty != DIFFICULTY_ANY) {
+        return record->difficulty;
+    }
+    if (record->nodes < 200) {
+        return DIFFICULTY_EASY;
+    }
+    if (record->nodes < 2000) {
+        return DIFFICULTY_MEDIUM;
+    }
+    return DIFFICULTY_HARD;
+}
+
+static const char *DIFFICULTY_NAMES[] = { "any", "easy", "medium", "hard" };
+
+bool parse_difficulty(const char *name, Difficulty *difficulty) {
+    for (int i = 0; i < 4; i++) {
+        if (strcmp(name, DIFFICULTY_NAMES[i]) == 0) {
+            *difficulty = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char *difficulty_name(Difficulty difficulty) {
+    return DIFFICULTY_NAMES[difficulty];
+}
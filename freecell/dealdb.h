@@ -0,0 +1,51 @@
+#ifndef DEALDB_H
+#define DEALDB_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Solver results for a range of numbered deals, built offline by
+// freecell-dealdb. The file is a DealDbHeader followed by one DealRecord per
+// deal in order, so a deal is found from its number alone. It is read in
+// place through mmap and written in the byte order of the machine that
+// built it.
+
+#define DEALDB_MAGIC 0x42444346 // "FCDB"
+#define DEALDB_VERSION 1
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t first_deal;
+    uint32_t num_deals;
+} DealDbHeader;
+
+typedef struct {
+    uint32_t nodes; // Positions the solver expanded
+    uint16_t moves; // Solution length, 0 if not solved
+    uint8_t status; // A SolveStatus
+    // A Difficulty ranked by freecell-classify against the other deals, or
+    // DIFFICULTY_ANY to judge by nodes alone
+    uint8_t difficulty;
+} DealRecord;
+
+typedef struct {
+    const DealDbHeader *header;
+    const DealRecord *records;
+    size_t size;
+} DealDb;
+
+typedef enum { DIFFICULTY_ANY, DIFFICULTY_EASY, DIFFICULTY_MEDIUM, DIFFICULTY_HARD } Difficulty;
+
+bool dealdb_open(DealDb *db, const char *path);
+void dealdb_close(DealDb *db);
+bool dealdb_write(const char *path, uint32_t first_deal, uint32_t num_deals, DealRecord records[]);
+const DealRecord *dealdb_lookup(DealDb *db, uint32_t deal);
+long dealdb_pick(DealDb *db, Difficulty difficulty);
+
+Difficulty deal_difficulty(const DealRecord *record);
+bool parse_difficulty(const char *name, Difficulty *difficulty);
+const char *difficulty_name(Difficulty difficulty);
+
+#endif // DEALDB_H
@@ -0,0 +1,109 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dealdb.h"
+#include "rules.h"
+#include "solver.h"
+#include "timer.h"
+
+static void usage() {
+    printf("usage: freecell-dealdb [--mode dfs|best|optimal] [--max-nodes N] [--tt-mb MB]\n");
+    printf("                       [--search-mb MB] --range FIRST-LAST FILE\n");
+    printf("       freecell-dealdb --query DEAL FILE\n");
+    printf("Builds FILE by solving deals FIRST to LAST, or looks one deal up in it\n");
+}
+
+static int query(const char *path, long deal) {
+    DealDb db;
+    if (!dealdb_open(&db, path)) {
+        fprintf(stderr, "couldn't open deal database %s\n", path);
+        return 1;
+    }
+    const DealRecord *record = dealdb_lookup(&db, deal);
+    if (!record) {
+        printf("deal %ld is not in %s (deals %u-%u)\n", deal, path, db.header->first_deal,
+                db.header->first_deal + db.header->num_deals - 1);
+        dealdb_close(&db);
+        return 2;
+    }
+    printf("%ld %s moves=%u nodes=%u difficulty=%s\n", deal, solve_status_name(record->status),
+            record->moves, record->nodes, difficulty_name(deal_difficulty(record)));
+    dealdb_close(&db);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    SolverOptions options = { SEARCH_BEST_FIRST, 1000000, DEFAULT_TT_MB };
+    long first = -1, last = -1;
+    long deal = -1;
+    const char *path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--mode") == 0 && i + 1 < argc) {
+            if (!parse_search_mode(argv[++i], &options.mode)) {
+                usage();
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--max-nodes") == 0 && i + 1 < argc) {
+            options.max_nodes = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--tt-mb") == 0 && i + 1 < argc) {
+            options.tt_mb = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--search-mb") == 0 && i + 1 < argc) {
+            options.search_mb = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--range") == 0 && i + 1 < argc) {
+            if (sscanf(argv[++i], "%ld-%ld", &first, &last) != 2) {
+                usage();
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--query") == 0 && i + 1 < argc) {
+            deal = atol(argv[++i]);
+        } else if (argv[i][0] != '-') {
+            path = argv[i];
+        } else {
+            usage();
+            return 1;
+        }
+    }
+    if (!path) {
+        usage();
+        return 1;
+    }
+    if (deal >= 0) {
+        return query(path, deal);
+    }
+    if (first < 0 || last < first || last > UINT32_MAX) {
+        usage();
+        return 1;
+    }
+
+    uint32_t num_deals = last - first + 1;
+    DealRecord *records = calloc(num_deals, sizeof(DealRecord));
+    long solved = 0;
+    uint64_t t = get_performance_counter();
+    Solver *solver = solver_new();
+    for (uint32_t i = 0; i < num_deals; i++) {
+        GameState game;
+        deal_from_number(&game, first + i);
+        Solution solution = solver_solve(solver, &game, options);
+        records[i].status = solution.status;
+        records[i].moves = solution.num_moves;
+        records[i].nodes = solution.nodes > UINT32_MAX ? UINT32_MAX : solution.nodes;
+        solved += solution.status == SOLVE_SOLVED;
+        free_solution(&solution);
+        if ((i + 1) % 1000 == 0) {
+            fprintf(stderr, "%u/%u deals\n", i + 1, num_deals);
+        }
+    }
+    solver_free(solver);
+    float seconds = (get_performance_counter() - t) / (float)get_performance_frequency();
+
+    if (!dealdb_write(path, first, num_deals, records)) {
+        fprintf(stderr, "couldn't write deal database %s\n", path);
+        free(records);
+        return 1;
+    }
+    printf("%u deals, %ld solved, in %.1f s\n", num_deals, solved, seconds);
+    free(records);
+    return 0;
+}
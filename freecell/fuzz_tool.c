@@ -0,0 +1,219 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "../common/fuzz_driver.h"
+#include "replay.h"
+#include "rules.h"
+#include "solver.h"
+
+// Plays random legal moves through the rules and checks after every move
+// that the game still makes sense, on the driver in common/ that
+// spider-fuzz shares.
+
+// CHECKS
+// ----------------------------------------
+
+// Whether can_move allows a move exactly when legal_moves lists it
+static const char *check_placement(GameState *game, Move moves[], int num_moves, Move move) {
+    bool listed = false;
+    for (int i = 0; i < num_moves && !listed; i++) {
+        listed = moves[i].from == move.from && moves[i].to == move.to && moves[i].count == move.count;
+    }
+    return listed == can_move(game, move) ? NULL : "can_move and legal_moves disagree";
+}
+
+// Whether move_capacity matches the free cells and empty columns counted
+// here, including asking for a move to an empty column when there is none
+static const char *check_capacity(GameState *game) {
+    int free_cells = 0;
+    for (int i = 0; i < NUM_FREE_CELLS; i++) {
+        free_cells += game->free_cells[i].suit == SUIT_NONE;
+    }
+    int empty_columns = 0;
+    for (int i = 0; i < NUM_COLUMNS; i++) {
+        empty_columns += game->column_len[i] == 0;
+    }
+    int capacity = (free_cells + 1) << empty_columns;
+    int capacity_empty = empty_columns > 0 ? capacity / 2 : capacity;
+    if (move_capacity(game, false) != capacity || move_capacity(game, true) != capacity_empty) {
+        return "move capacity miscounted";
+    }
+    return NULL;
+}
+
+// Everything that should hold between moves, or what doesn't
+static const char *check_game(GameState *game) {
+    int total = 0;
+    for (int i = 0; i < NUM_COLUMNS; i++) {
+        total += game->column_len[i];
+    }
+    if (total > 52) {
+        return "columns out of bounds";
+    }
+    // take_cards clears what it frees, so that equal positions compare equal
+    for (int i = total; i < 52; i++) {
+        if (game->cards[i].rank != 0 || game->cards[i].suit != SUIT_NONE) {
+            return "cards left past the columns";
+        }
+    }
+
+    bool seen[5][14] = {{false}};
+    int num_cards = 0;
+    for (int i = 0; i < total; i++) {
+        Card card = game->cards[i];
+        if (card.rank < 1 || card.rank > 13 || card.suit < SUIT_SPADE || card.suit > SUIT_DIAMOND
+                || seen[card.suit][card.rank]) {
+            return "card in the columns duplicated or invalid";
+        }
+        seen[card.suit][card.rank] = true;
+        num_cards++;
+    }
+    for (int i = 0; i < NUM_FREE_CELLS; i++) {
+        Card card = game->free_cells[i];
+        if (card.suit == SUIT_NONE) {
+            continue;
+        }
+        if (card.rank < 1 || card.rank > 13 || card.suit > SUIT_DIAMOND
+                || seen[card.suit][card.rank]) {
+            return "card in a free cell duplicated or invalid";
+        }
+        seen[card.suit][card.rank] = true;
+        num_cards++;
+    }
+    // Each foundation holds its suit from the ace up to the card on top
+    for (int i = 0; i < NUM_FOUNDATIONS; i++) {
+        Card top = game->destination_cells[i];
+        if (top.suit == SUIT_NONE) {
+            if (top.rank != 0) {
+                return "foundation out of order";
+            }
+            continue;
+        }
+        if (top.rank < 1 || top.rank > 13 || top.suit > SUIT_DIAMOND) {
+            return "foundation out of order";
+        }
+        for (int rank = 1; rank <= top.rank; rank++) {
+            if (seen[top.suit][rank]) {
+                return "foundation card also elsewhere";
+            }
+            seen[top.suit][rank] = true;
+            num_cards++;
+        }
+    }
+    if (num_cards != 52) {
+        return "cards gained or lost";
+    }
+
+    GameState recounted = *game;
+    recount_foundations(&recounted);
+    if (memcmp(recounted.foundation_rank, game->foundation_rank, sizeof(game->foundation_rank)) != 0
+            || memcmp(recounted.color_min_rank, game->color_min_rank,
+                sizeof(game->color_min_rank)) != 0) {
+        return "foundation counters out of date";
+    }
+    return check_capacity(game);
+}
+
+// Makes the move and checks the result, returning what went wrong if
+// anything did. The move is also undone and made again, since the solver
+// relies on undo_move restoring the game byte for byte.
+static const char *step(GameState *game, Move move) {
+    GameState before = *game;
+    apply_move(game, move);
+    GameState after = *game;
+    undo_move(game, move);
+    if (memcmp(game, &before, sizeof(before)) != 0) {
+        return "undo_move didn't restore the game";
+    }
+    *game = after;
+    return check_game(game);
+}
+
+// RULES
+// ----------------------------------------
+
+static void start(void *game, uint32_t deal) {
+    deal_from_number(game, deal);
+}
+
+// Random moves, with the safe foundation moves the game makes by itself
+// played after them now and then, each checked as a move of its own
+static int play_random(void *state, uint64_t *random, void *moves_out, const char **error) {
+    GameState *game = state;
+    Move *line = moves_out;
+    Move moves[MAX_MOVES];
+    int num_moves = legal_moves(game, moves);
+    if (num_moves == 0) {
+        return 0;
+    }
+    // Also try a move legal_moves may not have listed. One that can_move
+    // allows goes on the end of the line, where shrinking finds it.
+    Move other = { fuzz_random(random) % NUM_LOCATIONS,
+        fuzz_random(random) % NUM_LOCATIONS, 1 + fuzz_random(random) % 13 };
+    *error = check_placement(game, moves, num_moves, other);
+    if (*error) {
+        line[0] = other;
+        return 1;
+    }
+    int len = 0;
+    line[len] = moves[fuzz_random(random) % num_moves];
+    *error = check_placement(game, moves, num_moves, line[len]);
+    *error = *error ? *error : step(game, line[len]);
+    len++;
+    if (!*error && fuzz_random(random) % 4 == 0) {
+        GameState before = *game;
+        Move safe[52];
+        int num_safe = auto_moves(game, safe);
+        *game = before;
+        for (int j = 0; j < num_safe && !*error; j++) {
+            line[len] = safe[j];
+            *error = can_move(game, safe[j]) ? step(game, safe[j])
+                : "auto_moves made an illegal move";
+            len++;
+        }
+    }
+    return len;
+}
+
+static const char *play(void *state, const void *move_in, bool *illegal) {
+    GameState *game = state;
+    Move move = *(const Move *)move_in;
+    Move moves[MAX_MOVES];
+    int num_moves = legal_moves(game, moves);
+    const char *error = check_placement(game, moves, num_moves, move);
+    if (!error && !can_move(game, move)) {
+        *illegal = true;
+        return NULL;
+    }
+    return error ? error : step(game, move);
+}
+
+static void format(const void *move, char text[16]) {
+    format_move(*(const Move *)move, text);
+}
+
+static void record(Replay *replay, const void *move) {
+    replay_record(replay, *(const Move *)move);
+}
+
+// MAIN
+// ----------------------------------------
+
+int main(int argc, char **argv) {
+    FuzzRules rules = {
+        .name = "freecell-fuzz",
+        .options = "",
+        .deal_name = "deal",
+        .variant = REPLAY_FREECELL,
+        .game_size = sizeof(GameState),
+        .move_size = sizeof(Move),
+        // The safe moves that can follow the last random one
+        .extra_moves = 52,
+        .start = start,
+        .play_random = play_random,
+        .play = play,
+        .format = format,
+        .record = record,
+    };
+    return fuzz_main(&rules, argc, argv);
+}
@@ -1,3 +1,12 @@
+#include <assert.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
 #include "graphics.h"
 
 #define STB_IMAGE_IMPLEMENTATION
@@ -8,41 +17,44 @@
 
 static Graphics graphics;
 
+// Headless rendering: a surfaceless EGL context drawing into an FBO
+static struct {
+    EGLDisplay display;
+    EGLContext context;
+    GLuint fbo;
+    GLuint color;
+    GLuint depth;
+} headless;
+
+// Positions are vec3 so batched geometry can carry a depth. Immediate-mode
+// draws only upload x and y, and GL fills in z = 0.
 static GLchar *VERT_SRC_2D =
 "#version 330 core\n"
-"layout (location = 0) in vec2 position;\n"
+"layout (location = 0) in vec3 position;\n"
 "layout (location = 1) in vec4 color;\n"
-"out vec2 v_position;\n"
 "out vec4 v_color;\n"
 "void main() {\n"
 "    v_color = color;\n"
-"    gl_Position = vec4(position, 0.0, 1.0);\n"
+"    gl_Position = vec4(position, 1.0);\n"
 "}\n";
 
 static GLchar *FRAG_SRC_2D =
 "#version 330 core\n"
-"in vec2 v_position\n"
 "in vec4 v_color;\n"
 "out vec4 f_color;\n"
 "void main() {\n"
-"    f_color = vec4(1.0);\n"
-float t = 1.0 - smoothstep(5.0, 6.0, 0.5)
-"            float dist = distance(v_position, vec2(-0.5 + col, -0.5 - row));\n"
-"            float delta = fwidth(dist);\n"
-"            float alpha = smoothstep(0.45 - delta, 0.45, dist);\n"
-"            v_color = mix(v_color, v_color, alpha);\n"
-"    gl_FragColor = v_color;\n"
+"    f_color = v_color;\n"
 "}\n";
 
 static GLchar *VERT_SRC_TEXT =
 "#version 330 core\n"
-"layout (location = 0) in vec2 position;\n"
+"layout (location = 0) in vec3 position;\n"
 "layout (location = 1) in vec2 tex_coords;\n"
 "layout (location = 2) in vec4 color;\n"
 "out vec2 v_tex_coords;\n"
 "out vec4 v_color;\n"
 "void main() {\n"
-"    gl_Position = vec4(position, 0.0, 1.0);\n"
+"    gl_Position = vec4(position, 1.0);\n"
 "    v_tex_coords = tex_coords;\n"
 "    v_color = color;\n"
 "}\n";
@@ -54,16 +66,19 @@ static GLchar *FRAG_SRC_TEXT =
 "in vec4 v_color;\n"
 "out vec4 f_color;\n"
 "void main() {\n"
-"    f_color = v_color * vec4(1.0, 1.0, 1.0, texture(tex, v_tex_coords).r);\n"
+"    float dist = texture(tex, v_tex_coords).r;\n"
+"    float delta = fwidth(dist);\n"
+"    float alpha = smoothstep(0.5 - delta, 0.5 + delta, dist);\n"
+"    f_color = vec4(v_color.rgb, v_color.a * alpha);\n"
 "}\n";
 
 static GLchar *VERT_SRC_2D_TEXTURE =
 "#version 330 core\n"
-"layout (location = 0) in vec2 position;\n"
+"layout (location = 0) in vec3 position;\n"
 "layout (location = 1) in vec2 tex_coords;\n"
 "out vec2 v_tex_coords;\n"
 "void main() {\n"
-"    gl_Position = vec4(position, 0.0, 1.0);\n"
+"    gl_Position = vec4(position, 1.0);\n"
 "    v_tex_coords = tex_coords;\n"
 "}\n";
 
@@ -117,48 +132,283 @@ static GLuint create_program(const char *vert_src, const char *frag_src) {
     return program;
 }
 
-bool graphics_init(char *window_name, int width, int height) {
-    // TODO add error checking here
-    /* SDL_Window *window = SDL_CreateWindow(window_name, 0, 0, width, height, SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE); */
-    SDL_Window *window = SDL_CreateWindow(window_name, SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, width, height, SDL_WINDOW_OPENGL);
+// UPLOADS
+// ----------------------------------------
+//
+// All vertex and index data goes through one streaming buffer. With
+// GL_ARB_buffer_storage it is persistently mapped and split into
+// UPLOAD_REGIONS regions, one per frame in flight: a region is written only
+// after the fence placed at the end of the frame that last used it has
+// signalled. Without the extension the buffer is filled with
+// glBufferSubData and orphaned whenever it runs out of space.
+
+#define UPLOAD_REGIONS 3
+#define UPLOAD_REGION_SIZE (4 << 20)
+
+static struct {
+    GLuint buffer;
+    GLuint vao;
+    unsigned char *mapped; // NULL when orphaning
+    GLsync fences[UPLOAD_REGIONS];
+    int region;
+    GLsizeiptr offset; // Next free byte in the current region
+} upload;
+
+static void upload_init() {
+    glGenVertexArrays(1, &upload.vao);
+    glBindVertexArray(upload.vao);
+    glGenBuffers(1, &upload.buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, upload.buffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, upload.buffer);
+
+    if (GLEW_ARB_buffer_storage) {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_ARRAY_BUFFER, UPLOAD_REGIONS * UPLOAD_REGION_SIZE, NULL, flags);
+        upload.mapped = glMapBufferRange(GL_ARRAY_BUFFER, 0, UPLOAD_REGIONS * UPLOAD_REGION_SIZE, flags);
+    }
+    if (upload.mapped == NULL) {
+        glBufferData(GL_ARRAY_BUFFER, UPLOAD_REGION_SIZE, NULL, GL_STREAM_DRAW);
+    }
+    upload.region = 0;
+    upload.offset = 0;
+}
 
-    SDL_GL_SetAttribute( SDL_GL_CONTEXT_MAJOR_VERSION, 3 );
-    SDL_GL_SetAttribute( SDL_GL_CONTEXT_MINOR_VERSION, 3 );
-    SDL_GL_SetAttribute( SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE );
-    SDL_GLContext gl = SDL_GL_CreateContext(window);
+static void upload_free() {
+    for (int i = 0; i < UPLOAD_REGIONS; i++) {
+        if (upload.fences[i]) {
+            glDeleteSync(upload.fences[i]);
+            upload.fences[i] = 0;
+        }
+    }
+    if (upload.mapped) {
+        glBindBuffer(GL_ARRAY_BUFFER, upload.buffer);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+        upload.mapped = NULL;
+    }
+    glDeleteBuffers(1, &upload.buffer);
+    glDeleteVertexArrays(1, &upload.vao);
+}
+
+// Fences the current region and moves on to the next, waiting until the GPU
+// is done with whatever was last drawn from it. Only called between draws,
+// so the fence follows every draw that reads the region.
+static void upload_next_region() {
+    if (upload.mapped == NULL) {
+        return;
+    }
+    upload.fences[upload.region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    upload.region = (upload.region + 1) % UPLOAD_REGIONS;
+    upload.offset = 0;
+
+    GLsync fence = upload.fences[upload.region];
+    if (fence) {
+        while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED);
+        glDeleteSync(fence);
+        upload.fences[upload.region] = 0;
+    }
+}
+
+// Keeps every upload aligned for any attribute type
+static GLsizeiptr upload_align(GLsizeiptr size) {
+    return (size + 15) & ~(GLsizeiptr)15;
+}
+
+// Makes room for size bytes in the streaming buffer, moving to the next
+// region or orphaning the buffer if the current one is full, and returns
+// the byte offset to write them at. Everything one draw reads has to be
+// reserved at once, or making room could move it out from under the draw.
+static GLintptr upload_reserve(GLsizeiptr size) {
+    assert(size <= UPLOAD_REGION_SIZE);
+    GLsizeiptr aligned = upload_align(upload.offset);
+    if (aligned + size > UPLOAD_REGION_SIZE) {
+        if (upload.mapped) {
+            upload_next_region();
+        } else {
+            glBufferData(GL_ARRAY_BUFFER, UPLOAD_REGION_SIZE, NULL, GL_STREAM_DRAW);
+        }
+        aligned = 0;
+    }
+    upload.offset = aligned + size;
+    return upload.mapped ? upload.region * UPLOAD_REGION_SIZE + aligned : aligned;
+}
+
+static void upload_write(GLintptr offset, const void *data, GLsizeiptr size) {
+    if (upload.mapped) {
+        memcpy(upload.mapped + offset, data, size);
+    } else {
+        glBufferSubData(GL_ARRAY_BUFFER, offset, size, data);
+    }
+    graphics.frame.uploads++;
+}
+
+// Copies data into the streaming buffer and returns its byte offset there
+static GLintptr upload_data(const void *data, GLsizeiptr size) {
+    GLintptr offset = upload_reserve(size);
+    upload_write(offset, data, size);
+    return offset;
+}
 
+// Points attributes 0..n-1 at interleaved floats uploaded at offset, with
+// sizes[i] components each, and disables the rest
+static void bind_vertices(GLintptr offset, const int sizes[], int n) {
+    int stride = 0;
+    for (int i = 0; i < n; i++) {
+        stride += sizes[i];
+    }
+    GLintptr attrib_offset = offset;
+    for (int i = 0; i < 3; i++) {
+        if (i < n) {
+            glEnableVertexAttribArray(i);
+            glVertexAttribPointer(i, sizes[i], GL_FLOAT, GL_FALSE, stride * sizeof(GLfloat), (GLvoid*)attrib_offset);
+            attrib_offset += sizes[i] * sizeof(GLfloat);
+        } else {
+            glDisableVertexAttribArray(i);
+        }
+    }
+}
+
+// State shared by windowed and headless contexts, once a context is current
+static bool graphics_setup(int width, int height) {
+    glewExperimental = GL_TRUE;
     GLenum error = glewInit();
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+    // GLEW built against GLX complains under EGL but loads the entry points
+    if (error == GLEW_ERROR_NO_GLX_DISPLAY && graphics.headless) {
+        error = GLEW_OK;
+    }
+#endif
     if (error != GLEW_OK) {
         printf("Failed to initialize GLEW\n");
         return false;
     }
-    GLuint program_2d = create_program(VERT_SRC_2D, FRAG_SRC_2D);
-    GLuint program_text = create_program(VERT_SRC_TEXT, FRAG_SRC_TEXT);
-    GLuint program_texture = create_program(VERT_SRC_2D_TEXTURE, FRAG_SRC_2D_TEXTURE);
+    graphics.screen_width = width;
+    graphics.screen_height = height;
+    graphics.program_2d = create_program(VERT_SRC_2D, FRAG_SRC_2D);
+    graphics.program_text = create_program(VERT_SRC_TEXT, FRAG_SRC_TEXT);
+    graphics.program_texture = create_program(VERT_SRC_2D_TEXTURE, FRAG_SRC_2D_TEXTURE);
 
     glViewport(0, 0, width, height);
 
     glDepthFunc(GL_LESS);
     glEnable(GL_BLEND);
+    glEnable(GL_MULTISAMPLE);
 
-    graphics = (Graphics) {
-        window,
-        gl,
-        width,
-        height,
-        program_2d,
-        program_text,
-        program_texture,
+    upload_init();
+    return true;
+}
+
+bool graphics_init(char *window_name, int width, int height) {
+    // TODO add error checking here
+    /* SDL_Window *window = SDL_CreateWindow(window_name, 0, 0, width, height, SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE); */
+    SDL_GL_SetAttribute( SDL_GL_CONTEXT_MAJOR_VERSION, 3 );
+    SDL_GL_SetAttribute( SDL_GL_CONTEXT_MINOR_VERSION, 3 );
+    SDL_GL_SetAttribute( SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE );
+    SDL_GL_SetAttribute( SDL_GL_DEPTH_SIZE, 24 );
+    SDL_Window *window = SDL_CreateWindow(window_name, SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, width, height, SDL_WINDOW_OPENGL);
+
+    SDL_GLContext gl = SDL_GL_CreateContext(window);
+
+    graphics = (Graphics) {0};
+    graphics.window = window;
+    graphics.gl = gl;
+    return graphics_setup(width, height);
+}
+
+bool graphics_init_headless(int width, int height) {
+    graphics = (Graphics) {0};
+    graphics.headless = true;
+
+    // Prefer the Mesa surfaceless platform, which needs no display server
+    PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    headless.display = EGL_NO_DISPLAY;
+    if (get_platform_display) {
+        headless.display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    }
+    if (headless.display == EGL_NO_DISPLAY) {
+        headless.display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    }
+    if (headless.display == EGL_NO_DISPLAY || !eglInitialize(headless.display, NULL, NULL)) {
+        fprintf(stderr, "Failed to initialize EGL (error 0x%x)\n", eglGetError());
+        return false;
+    }
+
+    EGLint config_attribs[] = {
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_NONE,
+    };
+    EGLConfig config;
+    EGLint num_configs = 0;
+    if (!eglChooseConfig(headless.display, config_attribs, &config, 1, &num_configs) || num_configs == 0) {
+        // Surfaceless contexts can be created without a config
+        config = EGL_NO_CONFIG_KHR;
+    }
+    eglBindAPI(EGL_OPENGL_API);
+    EGLint context_attribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE,
     };
+    headless.context = eglCreateContext(headless.display, config, EGL_NO_CONTEXT, context_attribs);
+    if (headless.context == EGL_NO_CONTEXT
+            || !eglMakeCurrent(headless.display, EGL_NO_SURFACE, EGL_NO_SURFACE, headless.context)) {
+        fprintf(stderr, "Failed to create a headless GL 3.3 context (EGL error 0x%x)\n", eglGetError());
+        eglTerminate(headless.display);
+        return false;
+    }
+
+    if (!graphics_setup(width, height)) {
+        return false;
+    }
+
+    glGenRenderbuffers(1, &headless.color);
+    glBindRenderbuffer(GL_RENDERBUFFER, headless.color);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glGenRenderbuffers(1, &headless.depth);
+    glBindRenderbuffer(GL_RENDERBUFFER, headless.depth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+
+    glGenFramebuffers(1, &headless.fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, headless.fbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, headless.color);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, headless.depth);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        printf("Failed to create the offscreen framebuffer\n");
+        graphics_free();
+        return false;
+    }
     return true;
 }
 
 void graphics_free() {
+    upload_free();
+    if (graphics.headless) {
+        glDeleteFramebuffers(1, &headless.fbo);
+        glDeleteRenderbuffers(1, &headless.color);
+        glDeleteRenderbuffers(1, &headless.depth);
+        eglMakeCurrent(headless.display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglDestroyContext(headless.display, headless.context);
+        eglTerminate(headless.display);
+        return;
+    }
     SDL_GL_DeleteContext(graphics.gl);
 }
 
 void graphics_swap() {
-    SDL_GL_SwapWindow(graphics.window);
+    upload_next_region();
+    if (graphics.headless) {
+        // Nothing presents the frame, so wait for it as a swap would
+        glFinish();
+    } else {
+        SDL_GL_SwapWindow(graphics.window);
+    }
+    graphics.last_frame = graphics.frame;
+    graphics.frame = (FrameStats){0};
+}
+
+FrameStats get_frame_stats() {
+    return graphics.last_frame;
 }
 
 // Screen to OpenGL normalized coordinates
@@ -172,70 +422,26 @@ float gl_y(float y) {
 }
 
 void gl_draw_triangles(GLfloat vertex_data[], GLuint index_data[], int vertex_count, int triangle_count) {
-
-    glEnable(GL_MULTISAMPLE); // TODO only need this once
-    GLuint vao, vbo, ibo;
-
-    GLint vertex_pos_location = -1, vertex_color_location = -1;
-    vertex_pos_location = glGetAttribLocation(graphics.program_2d, "position");
-    vertex_color_location = glGetAttribLocation(graphics.program_2d, "color");
-    if (vertex_pos_location == -1 || vertex_color_location == -1) {
-        return;
-    }
-
-    glGenBuffers(1, &vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, 6 * vertex_count * sizeof(GLfloat), vertex_data, GL_STATIC_DRAW);
-
-    glGenBuffers(1, &ibo);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, 3 * triangle_count * sizeof(GLuint), index_data, GL_STATIC_DRAW);
-
-    /* glBindBuffer(GL_ARRAY_BUFFER, vbo); */
-
-    glGenVertexArrays(1, &vao);
-    glBindVertexArray(vao);
-
-    glEnableVertexAttribArray(vertex_pos_location);
-    glVertexAttribPointer(vertex_pos_location, 2, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), NULL);
-    glEnableVertexAttribArray(vertex_color_location);
-    glVertexAttribPointer(vertex_color_location, 4, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (void*)(2*sizeof(GLfloat)));
-
+    GLsizeiptr vertex_size = 6 * vertex_count * sizeof(GLfloat);
+    GLsizeiptr index_size = 3 * triangle_count * sizeof(GLuint);
+    GLintptr vertices = upload_reserve(upload_align(vertex_size) + index_size);
+    GLintptr indices = vertices + upload_align(vertex_size);
+    upload_write(vertices, vertex_data, vertex_size);
+    upload_write(indices, index_data, index_size);
+
+    bind_vertices(vertices, (int[]){2, 4}, 2);
     glUseProgram(graphics.program_2d);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
-    glDrawElements(GL_TRIANGLES, 3 * triangle_count, GL_UNSIGNED_INT, NULL);
-    glDisableVertexAttribArray(vertex_pos_location);
-    glUseProgram(0);
-
-    glDeleteVertexArrays(1, &vao);
-    glDeleteBuffers(1, &ibo);
-    glDeleteBuffers(1, &vbo);
+    glDrawElements(GL_TRIANGLES, 3 * triangle_count, GL_UNSIGNED_INT, (GLvoid*)indices);
+    graphics.frame.draw_calls++;
 }
 
 void gl_draw_triangles_2(GLfloat vertex_data[], int vertex_count) {
-    GLuint vao, vbo;
-
-    glGenBuffers(1, &vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, vertex_count * 6 * sizeof(GLfloat), vertex_data, GL_STATIC_DRAW);
-
-    glGenVertexArrays(1, &vao);
-    glBindVertexArray(vao);
-
-    GLsizei stride = 6 * sizeof(GLfloat);
-    glEnableVertexAttribArray(0);
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, stride, NULL);
-    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, stride, (GLvoid*)(2 * sizeof(GLfloat)));
+    GLintptr vertices = upload_data(vertex_data, vertex_count * 6 * sizeof(GLfloat));
 
+    bind_vertices(vertices, (int[]){2, 4}, 2);
     glUseProgram(graphics.program_2d);
-    glBindVertexArray(vao);
-    glDrawArrays(GL_TRIANGLES, 0, vertex_count * 6);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
-
-    glDeleteVertexArrays(1, &vao);
-    glDeleteBuffers(1, &vbo);
+    glDrawArrays(GL_TRIANGLES, 0, vertex_count);
+    graphics.frame.draw_calls++;
 }
 
 void draw_rect(Rect rect, Color color) {
@@ -351,14 +557,85 @@ Texture load_texture(char *filename) {
 }
 
 Font load_font(char *filename) {
+    Font font = {0};
 
-    unsigned char ttf_buffer[1<<20];
-    unsigned char temp_bitmap[256*256];
-    stbtt_bakedchar cdata[96];
-    GLuint tex;
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        printf("Failed to open font %s\n", filename);
+        return font;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        printf("Failed to read font %s\n", filename);
+        close(fd);
+        return font;
+    }
+    unsigned char *ttf = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (ttf == MAP_FAILED) {
+        printf("Failed to map font %s\n", filename);
+        return font;
+    }
+
+    stbtt_fontinfo info;
+    if (!stbtt_InitFont(&info, ttf, stbtt_GetFontOffsetForIndex(ttf, 0))) {
+        printf("Failed to parse font %s\n", filename);
+        munmap(ttf, st.st_size);
+        return font;
+    }
+    float scale = stbtt_ScaleForPixelHeight(&info, FONT_SDF_SIZE);
+    int ascent;
+    stbtt_GetFontVMetrics(&info, &ascent, NULL, NULL);
+
+    unsigned char *atlas = calloc(FONT_ATLAS_SIZE * FONT_ATLAS_SIZE, 1);
+    Glyph *glyphs = calloc(FONT_NUM_CHARS, sizeof(Glyph));
+
+    // Distance fields are packed into the atlas in rows
+    int pen_x = 0, pen_y = 0, row_h = 0;
+    for (int i = 0; i < FONT_NUM_CHARS; i++) {
+        int codepoint = FONT_FIRST_CHAR + i;
+        int advance, w, h, xoff, yoff;
+        stbtt_GetCodepointHMetrics(&info, codepoint, &advance, NULL);
+        glyphs[i].advance = advance * scale;
+
+        unsigned char *sdf = stbtt_GetCodepointSDF(
+                &info, scale, codepoint, FONT_SDF_PADDING,
+                128, 128.0f / FONT_SDF_PADDING, &w, &h, &xoff, &yoff);
+        if (sdf == NULL) {
+            continue; // Whitespace has no outline
+        }
+        if (pen_x + w > FONT_ATLAS_SIZE) {
+            pen_x = 0;
+            pen_y += row_h + 1;
+            row_h = 0;
+        }
+        if (pen_y + h > FONT_ATLAS_SIZE) {
+            printf("Font atlas full at '%c'\n", codepoint);
+            stbtt_FreeSDF(sdf, NULL);
+            break;
+        }
+        for (int y = 0; y < h; y++) {
+            memcpy(&atlas[(pen_y + y) * FONT_ATLAS_SIZE + pen_x], &sdf[y * w], w);
+        }
+        stbtt_FreeSDF(sdf, NULL);
+
+        glyphs[i] = (Glyph){
+            (float)pen_x / FONT_ATLAS_SIZE,
+            (float)pen_y / FONT_ATLAS_SIZE,
+            (float)(pen_x + w) / FONT_ATLAS_SIZE,
+            (float)(pen_y + h) / FONT_ATLAS_SIZE,
+            (float)xoff,
+            (float)yoff,
+            (float)w,
+            (float)h,
+            glyphs[i].advance,
+        };
+        pen_x += w + 1;
+        row_h = h > row_h ? h : row_h;
+    }
+    munmap(ttf, st.st_size);
 
-    fread(ttf_buffer, 1, 1<<20, fopen(filename, "rb"));
-    stbtt_BakeFontBitmap(ttf_buffer, 0, 20.0f, temp_bitmap, 256, 256, 32, 96, cdata);
+    GLuint tex;
     glGenTextures(1, &tex);
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, tex);
@@ -368,12 +645,19 @@ Font load_font(char *filename) {
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, 256, 256, 0, GL_RED, GL_UNSIGNED_BYTE, temp_bitmap);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, FONT_ATLAS_SIZE, FONT_ATLAS_SIZE, 0, GL_RED, GL_UNSIGNED_BYTE, atlas);
+    free(atlas);
 
-    Font font = { tex, cdata };
+    font = (Font){ tex, ascent * scale, glyphs };
     return font;
 }
 
+void free_font(Font font) {
+    glDeleteTextures(1, &font.tex);
+    free(font.glyphs);
+}
+
 Texture create_texture(int width, int height, unsigned char *data) {
     GLuint id = 0;
     glGenTextures(1, &id);
@@ -397,24 +681,33 @@ void draw_texture(Texture texture, Rect rect) {
     draw_partial_texture(texture, src_rect, rect);
 }
 
-void draw_text(Font font, int x, int y, Color color, char *text) {
+void draw_text(Font font, int x, int y, float size, Color color, char *text) {
+    if (font.glyphs == NULL) {
+        return;
+    }
 
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     glDisable(GL_DEPTH_TEST);
     glEnable(GL_BLEND);
 
+    // The atlas is rendered at FONT_SDF_SIZE; y is the top of the line
+    float scale = size / FONT_SDF_SIZE;
     float fx = (float)x;
-    float fy = (float)y;
+    float baseline = (float)y + font.ascent * scale;
 
     while (*text) {
-        if (*text >= 32 && *text < 128) {
-            stbtt_aligned_quad q;
-            stbtt_GetBakedQuad(font.cdata, 256, 256, *text - 32, &fx, &fy, &q, 1);
-
-            GLfloat x0 = (float)q.x0 * 2.0f / (float)graphics.screen_width - 1.0f;
-            GLfloat y0 = -1.0f * (((float)q.y0 + 16.0f) * 2.0f / (float)graphics.screen_height - 1.0f);
-            GLfloat x1 = (float)q.x1 * 2.0f / (float)graphics.screen_width - 1.0f;
-            GLfloat y1 = -1.0f * (((float)q.y1 + 16.0f) * 2.0f / (float)graphics.screen_height - 1.0f);
+        if (*text >= FONT_FIRST_CHAR && *text < FONT_FIRST_CHAR + FONT_NUM_CHARS) {
+            Glyph g = font.glyphs[*text - FONT_FIRST_CHAR];
+            float qx0 = fx + g.xoff * scale;
+            float qy0 = baseline + g.yoff * scale;
+            float qx1 = qx0 + g.w * scale;
+            float qy1 = qy0 + g.h * scale;
+            fx += g.advance * scale;
+
+            GLfloat x0 = qx0 * 2.0f / (float)graphics.screen_width - 1.0f;
+            GLfloat y0 = -1.0f * (qy0 * 2.0f / (float)graphics.screen_height - 1.0f);
+            GLfloat x1 = qx1 * 2.0f / (float)graphics.screen_width - 1.0f;
+            GLfloat y1 = -1.0f * (qy1 * 2.0f / (float)graphics.screen_height - 1.0f);
 
             float c[4] = {
                 (float)color.r / 255.0f,
@@ -423,41 +716,23 @@ void draw_text(Font font, int x, int y, Color color, char *text) {
                 (float)color.a / 255.0f,
             };
             GLfloat vertices[48] = {
-                x0, y0, q.s0, q.t0, c[0], c[1], c[2], c[3],
-                x1, y0, q.s1, q.t0, c[0], c[1], c[2], c[3],
-                x1, y1, q.s1, q.t1, c[0], c[1], c[2], c[3],
-                x0, y0, q.s0, q.t0, c[0], c[1], c[2], c[3],
-                x1, y1, q.s1, q.t1, c[0], c[1], c[2], c[3],
-                x0, y1, q.s0, q.t1, c[0], c[1], c[2], c[3],
+                x0, y0, g.s0, g.t0, c[0], c[1], c[2], c[3],
+                x1, y0, g.s1, g.t0, c[0], c[1], c[2], c[3],
+                x1, y1, g.s1, g.t1, c[0], c[1], c[2], c[3],
+                x0, y0, g.s0, g.t0, c[0], c[1], c[2], c[3],
+                x1, y1, g.s1, g.t1, c[0], c[1], c[2], c[3],
+                x0, y1, g.s0, g.t1, c[0], c[1], c[2], c[3],
             };
 
-            GLuint vao = 0;
-            GLuint vbo = 0;
-            GLint uniform = glGetUniformLocation(graphics.program_text, "tex");
-            glGenVertexArrays(1, &vao);
-            glGenBuffers(1, &vbo);
-            glBindBuffer(GL_ARRAY_BUFFER, vbo);
-            glBufferData(GL_ARRAY_BUFFER, 48 * sizeof(GLfloat), &vertices, GL_STATIC_DRAW);
-            glBindVertexArray(vao);
-            GLsizei stride = 8 * sizeof(GLfloat);
+            GLintptr offset = upload_data(vertices, sizeof(vertices));
             glActiveTexture(GL_TEXTURE0);
             glBindTexture(GL_TEXTURE_2D, font.tex);
-            glUniform1i(uniform, 0);
-
-            glEnableVertexAttribArray(0);
-            glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, stride, NULL);
-            glEnableVertexAttribArray(1);
-            glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (GLvoid*)(2 * sizeof(GLfloat)));
-            glEnableVertexAttribArray(2);
-            glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, stride, (GLvoid*)(4 * sizeof(GLfloat))); // TODO is this void pointer correct?
-
             glUseProgram(graphics.program_text);
-            glDrawArrays(GL_TRIANGLES, 0, 48);
-            glBindBuffer(GL_ARRAY_BUFFER, 0);
-            glBindVertexArray(0);
+            glUniform1i(glGetUniformLocation(graphics.program_text, "tex"), 0);
 
-            glDeleteBuffers(1, &vbo);
-            glDeleteVertexArrays(1, &vao);
+            bind_vertices(offset, (int[]){2, 2, 4}, 3);
+            glDrawArrays(GL_TRIANGLES, 0, 6);
+            graphics.frame.draw_calls++;
         }
 
         text++;
@@ -499,31 +774,15 @@ void gl_draw_textures(Texture texture, Rect src_rects[], Rect dest_rects[], int
         }
     }
 
-    GLuint vao = 0;
-    GLuint vbo = 0;
-    GLint uniform = glGetUniformLocation(graphics.program_texture, "tex");
-    glGenVertexArrays(1, &vao);
-    glGenBuffers(1, &vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, 24 * count * sizeof(GLfloat), vertices, GL_STATIC_DRAW);
-    glBindVertexArray(vao);
-    GLsizei stride = 4 * sizeof(GLfloat);
+    GLintptr offset = upload_data(vertices, 24 * count * sizeof(GLfloat));
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, texture.id);
-    glUniform1i(uniform, 0);
-
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, stride, NULL);
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (GLvoid*)(2 * sizeof(GLfloat)));
-
     glUseProgram(graphics.program_texture);
-    glDrawArrays(GL_TRIANGLES, 0, 24 * count);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+    glUniform1i(glGetUniformLocation(graphics.program_texture, "tex"), 0);
 
-    glDeleteBuffers(1, &vbo);
-    glDeleteVertexArrays(1, &vao);
+    bind_vertices(offset, (int[]){2, 2}, 2);
+    glDrawArrays(GL_TRIANGLES, 0, 6 * count);
+    graphics.frame.draw_calls++;
 
     free(vertices);
 }
@@ -552,31 +811,262 @@ void draw_partial_texture(Texture texture, Rect src_rect, Rect dest_rect) {
         x0, y1, tx0, ty1,
     };
 
-    GLuint vao = 0;
-    GLuint vbo = 0;
-    GLint uniform = glGetUniformLocation(graphics.program_texture, "tex");
-    glGenVertexArrays(1, &vao);
-    glGenBuffers(1, &vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, 24 * sizeof(GLfloat), &vertices, GL_STATIC_DRAW);
-    glBindVertexArray(vao);
-    GLsizei stride = 4 * sizeof(GLfloat);
+    GLintptr offset = upload_data(vertices, sizeof(vertices));
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, texture.id);
-    glUniform1i(uniform, 0);
+    glUseProgram(graphics.program_texture);
+    glUniform1i(glGetUniformLocation(graphics.program_texture, "tex"), 0);
 
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, stride, NULL);
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (GLvoid*)(2 * sizeof(GLfloat)));
+    bind_vertices(offset, (int[]){2, 2}, 2);
+    glDrawArrays(GL_TRIANGLES, 0, 6);
+    graphics.frame.draw_calls++;
+}
 
-    glUseProgram(graphics.program_texture);
-    glDrawArrays(GL_TRIANGLES, 0, 24);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+// BATCHING
+// ----------------------------------------
+//
+// Everything queued between begin_batch and flush_batch is grouped by
+// program and texture, so a whole table of cards takes a handful of draw
+// calls. Each item carries a layer and the depth buffer keeps the overlap
+// order: higher layers are drawn on top regardless of submission order.
+//
+// Shapes are flushed before textures and text. Textures and text sit a
+// fraction of a layer above the shapes on the same layer, so they show on
+// their own card but are hidden by anything on a higher layer. This relies
+// on overlays lying inside an opaque shape of their own layer, which holds
+// for card faces.
+
+typedef enum { BATCH_SHAPES, BATCH_TEXTURE, BATCH_TEXT } BatchKind;
+
+typedef struct {
+    BatchKind kind;
+    GLuint tex;
+    GLfloat *vertices;
+    int len; // floats used
+    int cap; // floats allocated
+} BatchGroup;
+
+#define MAX_BATCH_GROUPS 16
+#define MAX_BATCH_LAYERS 1024
+
+// Floats per vertex for each kind: position (3), then tex coords and/or color
+static const int BATCH_STRIDE[] = { 7, 5, 9 };
+
+static BatchGroup batch_groups[MAX_BATCH_GROUPS];
+static int batch_group_count = 0;
+
+// Layer (and sub-layer within it) to normalized device depth, nearer for
+// higher layers
+static float batch_depth(int layer, BatchKind kind) {
+    int slot = layer * 4 + (kind == BATCH_SHAPES ? 0 : 1) + (kind == BATCH_TEXT ? 1 : 0);
+    return 1.0f - 2.0f * (float)(slot + 1) / (float)(MAX_BATCH_LAYERS * 4 + 2);
+}
+
+static BatchGroup *batch_group(BatchKind kind, GLuint tex) {
+    for (int i = 0; i < batch_group_count; i++) {
+        if (batch_groups[i].kind == kind && batch_groups[i].tex == tex) {
+            return &batch_groups[i];
+        }
+    }
+    if (batch_group_count == MAX_BATCH_GROUPS) {
+        flush_batch();
+    }
+    // Slots keep their allocation from earlier frames
+    BatchGroup *group = &batch_groups[batch_group_count++];
+    group->kind = kind;
+    group->tex = tex;
+    group->len = 0;
+    return group;
+}
+
+static GLfloat *batch_reserve(BatchGroup *group, int vertex_count) {
+    int n = vertex_count * BATCH_STRIDE[group->kind];
+    if (group->len + n > group->cap) {
+        int cap = group->cap ? group->cap : 1024;
+        while (cap < group->len + n) cap *= 2;
+        group->vertices = realloc(group->vertices, cap * sizeof(GLfloat));
+        group->cap = cap;
+    }
+    GLfloat *out = &group->vertices[group->len];
+    group->len += n;
+    return out;
+}
+
+static void batch_triangle(BatchGroup *group, float z, float c[4],
+        float x0, float y0, float x1, float y1, float x2, float y2) {
+    GLfloat *v = batch_reserve(group, 3);
+    float xy[6] = { x0, y0, x1, y1, x2, y2 };
+    for (int i = 0; i < 3; i++) {
+        *v++ = gl_x(xy[i * 2]);
+        *v++ = gl_y(xy[i * 2 + 1]);
+        *v++ = z;
+        *v++ = c[0]; *v++ = c[1]; *v++ = c[2]; *v++ = c[3];
+    }
+}
+
+// Two triangles covering the screen-space rectangle, with an optional
+// texture rectangle and color
+static void batch_quad(BatchGroup *group, float z,
+        float x0, float y0, float x1, float y1,
+        float s0, float t0, float s1, float t1, float c[4]) {
+    GLfloat *v = batch_reserve(group, 6);
+    float corners[6][4] = {
+        { x0, y0, s0, t0 },
+        { x1, y0, s1, t0 },
+        { x1, y1, s1, t1 },
+        { x0, y0, s0, t0 },
+        { x1, y1, s1, t1 },
+        { x0, y1, s0, t1 },
+    };
+    for (int i = 0; i < 6; i++) {
+        *v++ = gl_x(corners[i][0]);
+        *v++ = gl_y(corners[i][1]);
+        *v++ = z;
+        if (group->kind != BATCH_SHAPES) {
+            *v++ = corners[i][2];
+            *v++ = corners[i][3];
+        }
+        if (group->kind != BATCH_TEXTURE) {
+            *v++ = c[0]; *v++ = c[1]; *v++ = c[2]; *v++ = c[3];
+        }
+    }
+}
+
+void begin_batch() {
+    batch_group_count = 0;
+}
 
-    glDeleteBuffers(1, &vbo);
-    glDeleteVertexArrays(1, &vao);
+void batch_rounded_rect(Rect rect, float cr, int layer, Color color) {
+    BatchGroup *group = batch_group(BATCH_SHAPES, 0);
+    float z = batch_depth(layer, BATCH_SHAPES);
+    float c[4] = {
+        (float)color.r / 255.0f,
+        (float)color.g / 255.0f,
+        (float)color.b / 255.0f,
+        (float)color.a / 255.0f,
+    };
+    float x = (float)rect.x;
+    float y = (float)rect.y;
+    float w = (float)rect.w;
+    float h = (float)rect.h;
+
+    batch_quad(group, z, x + cr, y, x + w - cr, y + h, 0, 0, 0, 0, c);
+    batch_quad(group, z, x, y + cr, x + cr, y + h - cr, 0, 0, 0, 0, c);
+    batch_quad(group, z, x + w - cr, y + cr, x + w, y + h - cr, 0, 0, 0, 0, c);
+
+    // Quarter circle fans, same tessellation as gl_draw_circle_arc
+    float centers[4][2] = {
+        { x + w - cr, y + cr },
+        { x + cr, y + cr },
+        { x + cr, y + h - cr },
+        { x + w - cr, y + h - cr },
+    };
+    int n = 10;
+    for (int corner = 0; corner < 4; corner++) {
+        float cx = centers[corner][0];
+        float cy = centers[corner][1];
+        float theta = corner * M_PI_2;
+        for (int t = 0; t < n; t++) {
+            float a0 = theta + (float)t * M_PI_2 / (float)n;
+            float a1 = theta + (float)(t + 1) * M_PI_2 / (float)n;
+            batch_triangle(group, z, c,
+                    cx, cy,
+                    cx + cr * cosf(a0), cy - cr * sinf(a0),
+                    cx + cr * cosf(a1), cy - cr * sinf(a1));
+        }
+    }
+}
+
+void batch_texture(Texture texture, Rect src_rect, Rect dest_rect, int layer) {
+    BatchGroup *group = batch_group(BATCH_TEXTURE, texture.id);
+    batch_quad(group, batch_depth(layer, BATCH_TEXTURE),
+            (float)dest_rect.x,
+            (float)dest_rect.y,
+            (float)(dest_rect.x + dest_rect.w),
+            (float)(dest_rect.y + dest_rect.h),
+            (float)src_rect.x / (float)texture.width,
+            (float)src_rect.y / (float)texture.height,
+            (float)(src_rect.x + src_rect.w) / (float)texture.width,
+            (float)(src_rect.y + src_rect.h) / (float)texture.height,
+            NULL);
+}
+
+void batch_text(Font font, int x, int y, float size, int layer, Color color, char *text) {
+    if (font.glyphs == NULL) {
+        return;
+    }
+    BatchGroup *group = batch_group(BATCH_TEXT, font.tex);
+    float z = batch_depth(layer, BATCH_TEXT);
+    float c[4] = {
+        (float)color.r / 255.0f,
+        (float)color.g / 255.0f,
+        (float)color.b / 255.0f,
+        (float)color.a / 255.0f,
+    };
+    float scale = size / FONT_SDF_SIZE;
+    float fx = (float)x;
+    float baseline = (float)y + font.ascent * scale;
+
+    for (; *text; text++) {
+        if (*text < FONT_FIRST_CHAR || *text >= FONT_FIRST_CHAR + FONT_NUM_CHARS) {
+            continue;
+        }
+        Glyph g = font.glyphs[*text - FONT_FIRST_CHAR];
+        float x0 = fx + g.xoff * scale;
+        float y0 = baseline + g.yoff * scale;
+        fx += g.advance * scale;
+        if (g.w > 0) {
+            batch_quad(group, z, x0, y0, x0 + g.w * scale, y0 + g.h * scale,
+                    g.s0, g.t0, g.s1, g.t1, c);
+        }
+    }
+}
+
+static void flush_batch_group(BatchGroup *group) {
+    if (group->len == 0) {
+        return;
+    }
+    int stride_floats = BATCH_STRIDE[group->kind];
+    GLuint program = group->kind == BATCH_SHAPES ? graphics.program_2d
+        : group->kind == BATCH_TEXTURE ? graphics.program_texture
+        : graphics.program_text;
+
+    GLintptr offset = upload_data(group->vertices, group->len * sizeof(GLfloat));
+    glUseProgram(program);
+    if (group->kind == BATCH_SHAPES) {
+        bind_vertices(offset, (int[]){3, 4}, 2);
+    } else {
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, group->tex);
+        glUniform1i(glGetUniformLocation(program, "tex"), 0);
+        if (group->kind == BATCH_TEXT) {
+            bind_vertices(offset, (int[]){3, 2, 4}, 3);
+        } else {
+            bind_vertices(offset, (int[]){3, 2}, 2);
+        }
+    }
+
+    glDrawArrays(GL_TRIANGLES, 0, group->len / stride_floats);
+    graphics.frame.draw_calls++;
+    group->len = 0;
+}
+
+void flush_batch() {
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glEnable(GL_BLEND);
+    glEnable(GL_DEPTH_TEST);
+    glDepthMask(GL_TRUE);
+
+    for (BatchKind kind = BATCH_SHAPES; kind <= BATCH_TEXT; kind++) {
+        for (int i = 0; i < batch_group_count; i++) {
+            if (batch_groups[i].kind == kind) {
+                flush_batch_group(&batch_groups[i]);
+            }
+        }
+    }
+    batch_group_count = 0;
+
+    glDisable(GL_DEPTH_TEST);
 }
 
 void clear_screen(int r, int g, int b, int a) {
@@ -585,7 +1075,7 @@ void clear_screen(int r, int g, int b, int a) {
             (float)g / 255.0f,
             (float)b / 255.0f,
             (float)a / 255.0f);
-    glClear(GL_COLOR_BUFFER_BIT);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 }
 
 int get_screen_width() {
@@ -23,6 +23,12 @@ typedef struct {
     int h;
 } Rect;
 
+// GL work submitted during one frame
+typedef struct {
+    int draw_calls;
+    int uploads;
+} FrameStats;
+
 typedef struct {
     SDL_Window *window;
     SDL_GLContext gl;
@@ -31,6 +37,9 @@ typedef struct {
     GLuint program_2d;
     GLuint program_text;
     GLuint program_texture;
+    bool headless;
+    FrameStats frame;
+    FrameStats last_frame;
 } Graphics;
 
 typedef struct {
@@ -39,27 +48,54 @@ typedef struct {
     int height;
 } Texture;
 
+/* Glyphs are rendered as signed distance fields at this pixel height, and
+ * scaled to whatever size draw_text asks for. */
+#define FONT_SDF_SIZE 32.0f
+#define FONT_SDF_PADDING 4
+#define FONT_ATLAS_SIZE 512
+#define FONT_FIRST_CHAR 32
+#define FONT_NUM_CHARS 96
+
+typedef struct {
+    // Atlas texture coordinates
+    float s0, t0, s1, t1;
+    // Quad offset from the pen position and size, at FONT_SDF_SIZE
+    float xoff, yoff;
+    float w, h;
+    float advance;
+} Glyph;
+
 typedef struct {
     GLuint tex;
-    stbtt_bakedchar *cdata;
+    float ascent;
+    Glyph *glyphs; // FONT_NUM_CHARS entries, owned by the font
 } Font;
 
 bool graphics_init(char *window_name, int width, int height);
+bool graphics_init_headless(int width, int height);
 void graphics_free();
 void graphics_swap();
+FrameStats get_frame_stats();
 
 void draw_rect(Rect rect, Color color);
 Texture load_texture(char *filename);
 Font load_font(char *filename);
+void free_font(Font font);
 Texture create_texture(int width, int height, unsigned char *data);
 void free_texture(Texture texture);
 void draw_texture(Texture texture, Rect rect);
 void gl_draw_textures(Texture texture, Rect src_rects[], Rect dest_rects[], int count);
-void draw_text(Font font, int x, int y, Color color, char *text);
+void draw_text(Font font, int x, int y, float size, Color color, char *text);
 void draw_partial_texture(Texture texture, Rect src_rect, Rect dest_rect);
 void draw_rounded_rect(Rect rect, float cr, Color color);
 void gl_draw_rounded_rect(float x, float y, float w, float h, float cr, Color color);
 void clear_screen(int r, int g, int b, int a);
+
+void begin_batch();
+void batch_rounded_rect(Rect rect, float cr, int layer, Color color);
+void batch_texture(Texture texture, Rect src_rect, Rect dest_rect, int layer);
+void batch_text(Font font, int x, int y, float size, int layer, Color color, char *text);
+void flush_batch();
 int get_screen_width();
 int get_screen_height();
 
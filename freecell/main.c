@@ -1,28 +1,34 @@
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stdlib.h>
 #include <time.h>
 #include <assert.h>
 #include <stdint.h>
+#include <string.h>
 
+#include "dealdb.h"
 #include "graphics.h"
+#include "move_queue.h"
+#include "profiler.h"
+#include "replay.h"
+#include "rules.h"
+#include "snapshot.h"
+#include "solver.h"
 #include "timer.h"
 
-#define MAIN_PILE_COUNT 8
-
 // TODO this should be dynamic for scaling
 #define STACKING_OFFSET 24
 
-typedef enum { SUIT_NONE, SUIT_SPADE, SUIT_CLUB, SUIT_HEART, SUIT_DIAMOND } Suit;
-typedef struct {
-    int rank;
-    Suit suit;
-} Card;
+// How often a game in progress is saved, besides on exit
+#define SNAPSHOT_INTERVAL_SECONDS 5
+
+// Frames each move of an auto-solve or replay takes to slide into place at
+// normal speed
+#define AUTO_MOVE_FRAMES 8
 
 // GLOBAL VARS
 // ----------------------------------------
 
-Card CARD_NONE = {0};
-
 // Resources
 Texture tex_card_back;
 Texture tex_card_front;
@@ -31,121 +37,302 @@ Texture tex_card_text;
 
 Font font;
 
-// HELPER FUNCTIONS
-// ----------------------------------------
-
-int pile_len(Card pile[]) {
-    int i = 0;
-    while (i < 52 && pile[i].suit != SUIT_NONE) i += 1;
-    return i;
-}
-
-void shuffle(Card deck[], int num_cards) {
-    if (num_cards > 1) {
-        for (int i = 0; i < num_cards - 1; i++) {
-            int j = i + rand() / (RAND_MAX / (num_cards - i) + 1);
-            Card card = deck[j];
-            deck[j] = deck[i];
-            deck[i] = card;
-        }
-    }
-}
-
 // HELPER PROCS
 // ----------------------------------------
 
-void draw_card(Card card, Rect rect) {
-    Rect suit_src_rect = {
-        tex_card_suits.height * (card.suit - 1),
-        0,
-        tex_card_suits.width / 4,
-        tex_card_suits.height,
-    };
-    Rect suit_dest_rect = {
-        rect.x + 5,
-        rect.y + 5,
-        16,
-        16,
-    };
-
-    /* draw_texture(tex_card_front, rect); */
-    Rect rect2 = rect;
-    rect2.x -= 2;
-    rect2.y -= 2;
-    rect2.w += 4;
-    rect2.h += 4;
-    /* draw_rounded_rect(rect2, 12.0f, (Color){0, 0, 0, 255}); */
-    draw_rounded_rect(rect, 10.0f, (Color){255, 255, 255, 255});
-    /* draw_rect(rect, (Color){255, 255, 255, 255}); */
-    draw_partial_texture(tex_card_suits, suit_src_rect, suit_dest_rect);
-
-    char *text[] = {"NONE", "A", "2", "3", "4", "5", "6", "7", "8", "9", "10", "J", "Q", "K"};
-    Color c;
-    if (card.suit / 3 == 0) {
-        c = (Color){0, 0, 0, 255};
-    } else {
-        c = (Color){255, 0, 0, 255};
-    }
-    draw_text(font, rect.x + 25, rect.y + 3, c, text[card.rank]);
-}
-
+// Draws the cards in order, each one on top of the ones before it
 void draw_cards(Card cards[], Rect rects[], int count) {
+    char *text[] = {"NONE", "A", "2", "3", "4", "5", "6", "7", "8", "9", "10", "J", "Q", "K"};
 
-    Rect *card_src_rects = malloc(count * sizeof(Rect));
-    Rect *suit_src_rects = malloc(count * sizeof(Rect));
-    Rect *suit_dest_rects = malloc(count * sizeof(Rect));
+    begin_batch();
     for (int i = 0; i < count; i++) {
         Card card = cards[i];
         Rect rect = rects[i];
-        card_src_rects[i] = (Rect){
-            0,
-            0,
-            tex_card_front.width,
-            tex_card_front.height,
-        };
-        suit_src_rects[i] = (Rect){
+        Rect suit_src_rect = {
             tex_card_suits.height * (card.suit - 1),
             0,
             tex_card_suits.width / 4,
             tex_card_suits.height,
         };
-        suit_dest_rects[i] = (Rect){
+        Rect suit_dest_rect = {
             rect.x + 5,
             rect.y + 5,
             16,
             16,
         };
+        Color c;
+        if (card_color(card) == 0) {
+            c = (Color){0, 0, 0, 255};
+        } else {
+            c = (Color){255, 0, 0, 255};
+        }
+
+        batch_rounded_rect(rect, 10.0f, i, (Color){255, 255, 255, 255});
+        batch_texture(tex_card_suits, suit_src_rect, suit_dest_rect, i);
+        batch_text(font, rect.x + 25, rect.y + 3, rect.w / 5.0f, i, c, text[card.rank]);
     }
+    flush_batch();
+}
 
-    gl_draw_textures(tex_card_front, card_src_rects, rects, count);
-    draw_partial_texture(tex_card_front, card_src_rects[0], rects[0]);
-    gl_draw_textures(tex_card_suits, suit_src_rects, suit_dest_rects, count);
+// Where a card is drawn: idx counts up from the bottom of a column, and is
+// ignored for free cells and foundations
+Rect card_rect(int location, int idx, int card_width, int card_height) {
+    if (location < FIRST_FREE_CELL) {
+        return (Rect){
+            location * card_width + 1,
+            card_height + idx * STACKING_OFFSET + 1,
+            card_width - 2,
+            card_height - 2,
+        };
+    }
+    int slot = location < FIRST_FOUNDATION
+        ? location - FIRST_FREE_CELL
+        : location - FIRST_FOUNDATION + NUM_FREE_CELLS;
+    return (Rect){ slot * card_width + 1, 1, card_width - 2, card_height - 2 };
+}
 
-    for (int i = 0; i < count; i++) {
-        Card card = cards[i];
-        Rect rect = rects[i];
+// AUTO-SOLVE
+// ----------------------------------------
 
-        char *text[] = {"NONE", "A", "2", "3", "4", "5", "6", "7", "8", "9", "10", "J", "Q", "K"};
-        Color c;
-        if (card.suit / 3 == 0) {
-            c = (Color){0, 0, 0, 255};
+// Solves from a copy of the table on a worker thread. The moves come back
+// through a lock-free queue, so the frame loop only ever polls.
+typedef struct {
+    SDL_Thread *thread;
+    GameState start;
+    MoveQueue queue;
+    atomic_int cancel;
+    atomic_int done; // Set once every move is queued or the search failed
+    SolveStatus status; // Only read once done is set
+} AutoSolver;
+
+// Moves of a solution queued at once. The search runs again from where they
+// leave the game while they are played out.
+#define AUTO_SOLVE_CHUNK 8
+
+// Nodes for each search after the first, which only looks for a shorter way
+// on and so mustn't keep the queue waiting
+#define AUTO_SOLVE_IMPROVE_NODES 20000
+
+// Returns false if cancelled first. The queue only fills up on very long
+// solutions, and drains a move every few frames.
+static bool auto_solve_push(AutoSolver *solver, Move move) {
+    while (!move_queue_push(&solver->queue, move)) {
+        if (atomic_load(&solver->cancel)) return false;
+        SDL_Delay(1);
+    }
+    return true;
+}
+
+// Moves are queued as soon as they are certain. The safe moves from the
+// start go first, before any searching. Then the solution goes a chunk at a
+// time: any prefix of a solution is certain, since the rest of it wins from
+// there. After each chunk a smaller search looks for a shorter way on from
+// the end of it, and the shorter of the two is kept.
+int auto_solve_thread(void *data) {
+    AutoSolver *solver = data;
+    SolverOptions options = { SEARCH_BEST_FIRST, 2000000, DEFAULT_TT_MB, &solver->cancel };
+    GameState game = solver->start;
+    Move safe[52];
+    int num_safe = auto_moves(&game, safe);
+    bool pushing = true;
+    for (int i = 0; i < num_safe && pushing; i++) {
+        pushing = auto_solve_push(solver, safe[i]);
+    }
+
+    Solver *search = solver_new();
+    Solution known = solver_solve(search, &game, options);
+    solver->status = known.status;
+    options.max_nodes = AUTO_SOLVE_IMPROVE_NODES;
+    int next = 0; // Next move of known to queue
+    while (pushing && known.status == SOLVE_SOLVED && next < known.num_moves) {
+        int end = next + AUTO_SOLVE_CHUNK < known.num_moves ? next + AUTO_SOLVE_CHUNK : known.num_moves;
+        for (; next < end && pushing; next++) {
+            apply_move(&game, known.moves[next]);
+            pushing = auto_solve_push(solver, known.moves[next]);
+        }
+        if (!pushing || next == known.num_moves) {
+            break;
+        }
+        Solution better = solver_solve(search, &game, options);
+        if (better.status == SOLVE_SOLVED && better.num_moves < known.num_moves - next) {
+            free_solution(&known);
+            known = better;
+            next = 0;
         } else {
-            c = (Color){255, 0, 0, 255};
+            free_solution(&better);
         }
-        draw_text(font, rect.x + 25, rect.y + 3, c, text[card.rank]);
     }
+    free_solution(&known);
+    solver_free(search);
+    atomic_store(&solver->done, 1);
+    return 0;
+}
+
+bool auto_solve_start(AutoSolver *solver, GameState *game) {
+    solver->start = *game;
+    move_queue_init(&solver->queue);
+    atomic_init(&solver->cancel, 0);
+    atomic_init(&solver->done, 0);
+    solver->thread = SDL_CreateThread(auto_solve_thread, "solve", solver);
+    return solver->thread != NULL;
+}
+
+// Asks the worker to stop. It gives up within a few thousand positions.
+void auto_solve_cancel(AutoSolver *solver) {
+    atomic_store(&solver->cancel, 1);
+}
 
-    free(card_src_rects);
-    free(suit_src_rects);
-    free(suit_dest_rects);
+// Waits for the worker to finish. Only blocks if it was neither done nor
+// cancelled.
+void auto_solve_join(AutoSolver *solver) {
+    if (solver->thread) {
+        SDL_WaitThread(solver->thread, NULL);
+        solver->thread = NULL;
+    }
+}
+
+// Scripted input for --bench. Every BENCH_MOVE_FRAMES frames, pick up the
+// top card of a column and drag it across the table onto another column.
+#define BENCH_MOVE_FRAMES 20
+
+void bench_input(int frame, GameState *game, int card_width, int card_height,
+        int *mouse_x, int *mouse_y, bool *pressed, bool *released) {
+    int move = frame / BENCH_MOVE_FRAMES;
+    int step = frame % BENCH_MOVE_FRAMES;
+    int src = move % NUM_COLUMNS;
+    for (int i = 0; i < NUM_COLUMNS && game->column_len[src] == 0; i++) {
+        src = (src + 1) % NUM_COLUMNS;
+    }
+    int dst = (src + 3 + move / NUM_COLUMNS) % NUM_COLUMNS;
+
+    // Below the last card of a column selects the last card
+    int y = card_height + 52 * STACKING_OFFSET;
+    int x0 = src * card_width + card_width / 2;
+    int x1 = dst * card_width + card_width / 2;
+    *mouse_x = x0 + (x1 - x0) * step / (BENCH_MOVE_FRAMES - 1);
+    *mouse_y = y;
+    *pressed = step == 0;
+    *released = step == BENCH_MOVE_FRAMES - 1;
+}
+
+// Starts a new game: a deal from the database matching the filter when
+// there is one, otherwise any numbered deal, so every game can be replayed
+// from its number. Returns the deal number.
+uint32_t new_game(GameState *game, DealDb *db, bool filter, Difficulty difficulty) {
+    long deal = filter ? dealdb_pick(db, difficulty) : -1;
+    if (deal < 0) {
+        deal = 1 + ((uint32_t)rand() * (RAND_MAX + 1u) + rand()) % 0x7ffffffe;
+    }
+    deal_from_number(game, deal);
+    printf("Deal %ld\n", deal);
+    return deal;
+}
+
+// Writes out the game so far, if there was one, and starts recording the
+// next
+void next_replay(Replay *replay, const char *path, uint32_t deal) {
+    if (path && replay->header.num_moves > 0 && !replay_append(replay, path)) {
+        printf("Couldn't write replay to %s\n", path);
+    }
+    replay_start(replay, REPLAY_FREECELL, deal);
+}
+
+// Where the game in progress is kept between runs, or NULL if there is
+// nowhere to keep it. Must be freed with SDL_free.
+char *snapshot_path() {
+    char *dir = SDL_GetPrefPath("solitaire", "freecell");
+    if (!dir) {
+        return NULL;
+    }
+    size_t len = strlen(dir) + strlen("freecell.snapshot") + 1;
+    char *path = SDL_malloc(len);
+    if (path) {
+        snprintf(path, len, "%sfreecell.snapshot", dir);
+    }
+    SDL_free(dir);
+    return path;
 }
 
 // MAIN
 // ----------------------------------------
 
 int main(int argc, char **argv) {
-    srand(time(NULL));
-    assert(graphics_init("Freecell", 800, 600));
+    // With --bench N, render N frames of scripted play offscreen and report
+    // timings instead of opening a window. With --deal N, play Microsoft
+    // FreeCell deal number N instead of a random one. With --db FILE, a
+    // database built by freecell-dealdb, --solvable and --difficulty D only
+    // deal numbered deals it knows to be solvable, of that difficulty. With
+    // --record FILE, every game is added to FILE as a replay when the next
+    // starts or the game exits. With --replay FILE, the first game in FILE
+    // plays itself out, --speed X times as fast as normal. Otherwise the
+    // game in progress is saved on exit and now and then, and picked up
+    // again on the next start.
+    int bench_frames = 0;
+    long deal_number = -1;
+    const char *record_path = NULL;
+    const char *replay_path = NULL;
+    float speed = 1.0f;
+    const char *db_path = NULL;
+    bool db_filter = false;
+    Difficulty difficulty = DIFFICULTY_ANY;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--bench") == 0 && i + 1 < argc) {
+            bench_frames = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--deal") == 0 && i + 1 < argc) {
+            deal_number = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--db") == 0 && i + 1 < argc) {
+            db_path = argv[++i];
+        } else if (strcmp(argv[i], "--solvable") == 0) {
+            db_filter = true;
+        } else if (strcmp(argv[i], "--difficulty") == 0 && i + 1 < argc) {
+            if (!parse_difficulty(argv[++i], &difficulty)) {
+                fprintf(stderr, "unknown difficulty %s, expected any, easy, medium or hard\n", argv[i]);
+                return 1;
+            }
+            db_filter = true;
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            record_path = argv[++i];
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replay_path = argv[++i];
+        } else if (strcmp(argv[i], "--speed") == 0 && i + 1 < argc) {
+            speed = atof(argv[++i]);
+            speed = speed > 0 ? speed : 1.0f;
+        }
+    }
+
+    // The game being played back, with playback_pos the next move in it
+    Replay playback = {0};
+    size_t playback_pos = 0;
+    bool replaying = false;
+    if (replay_path) {
+        FILE *f = fopen(replay_path, "rb");
+        replaying = f && replay_read(&playback, f) == 1
+            && playback.header.variant == REPLAY_FREECELL;
+        if (!replaying) {
+            printf("Couldn't read a FreeCell replay from %s\n", replay_path);
+        }
+        if (f) {
+            fclose(f);
+        }
+    }
+
+    DealDb db = {0};
+    if (db_path && !dealdb_open(&db, db_path)) {
+        printf("Couldn't open deal database %s\n", db_path);
+    }
+
+    if (bench_frames > 0) {
+        srand(1);
+        // Expected to fail on a box without EGL or a software GL driver,
+        // which graphics_init_headless has already said more about
+        if (!graphics_init_headless(800, 600)) {
+            fprintf(stderr, "couldn't render offscreen for --bench, which needs EGL and OpenGL 3.3\n");
+            return 1;
+        }
+    } else {
+        srand(time(NULL));
+        assert(graphics_init("Freecell", 800, 600));
+    }
 
     tex_card_back = load_texture("../res/card_back.png");
     tex_card_front = load_texture("../res/card_front.png");
@@ -154,30 +341,48 @@ int main(int argc, char **argv) {
 
     font = load_font("../res/Vera.ttf");
 
-    // Game Data
-    Card deck[52];
-    for (int suit = 0; suit < 4; suit++) {
-        for (int rank = 0; rank < 13; rank++) {
-            deck[suit * 13 + rank] = (Card){rank + 1, suit + 1};
-        }
+    // Game Data. A replay doesn't save over the game in progress, and a
+    // resumed game isn't recorded, since the moves before the snapshot are
+    // gone.
+    GameState game;
+    Replay replay = {0};
+    bool explicit_game = bench_frames > 0 || replay_path || deal_number >= 0 || db_filter;
+    char *save_path = bench_frames > 0 || replay_path ? NULL : snapshot_path();
+    Snapshot snapshot = {0};
+    bool resumed = !explicit_game && save_path && snapshot_load(save_path, &snapshot)
+        && !game_won(&snapshot.game);
+    bool recording = !resumed;
+    if (replaying) {
+        deal_number = playback.header.seed;
     }
-    shuffle(deck, 52);
-    Card piles[MAIN_PILE_COUNT][52] = {0};
-    for (int i = 0; i < 52; i++) {
-        piles[i % MAIN_PILE_COUNT][i / MAIN_PILE_COUNT] = deck[i];
+    if (resumed) {
+        game = snapshot.game;
+        deal_number = snapshot.deal;
+    } else if (deal_number >= 0) {
+        deal_from_number(&game, deal_number);
+    } else {
+        deal_number = new_game(&game, &db, db_filter, difficulty);
     }
+    replay_start(&replay, REPLAY_FREECELL, deal_number);
+    uint64_t last_save = get_performance_counter();
 
-    Card free_cells[4] = {0};
-    Card destination_cells[4] = {0};
-    Card held_pile[52] = {0};
+    // Cards being dragged: the top held_count cards of held_from
+    int held_from = 0;
+    int held_count = 0;
 
-    int last_active_pile = 0;
+    // Auto-solve: 'a' starts it, and it or a replay stops on any click or
+    // key. anim_move is sliding into place while anim_frame counts up to
+    // AUTO_MOVE_FRAMES, speed frames at a time.
+    AutoSolver auto_solver = {0};
+    bool auto_solving = false;
+    Move anim_move = {0};
+    float anim_frame = -1;
 
     // Geometry
     int card_width, card_height;
     {
         int width = get_screen_width();
-        card_width = width / MAIN_PILE_COUNT;
+        card_width = width / NUM_COLUMNS;
         card_height = card_width * tex_card_front.height / tex_card_front.width;
     }
     int mouse_offset_x = card_width / 2;
@@ -190,157 +395,138 @@ int main(int argc, char **argv) {
     SDL_Event event;
     bool quit = false;
 
-    uint64_t t = get_performance_counter();
     uint64_t t_freq = get_performance_frequency();
+    bool show_profiler = false;
+    profiler_init();
+
+    int frame = 0;
+    uint64_t bench_start = get_performance_counter();
+    long bench_draw_calls = 0;
+    long bench_uploads = 0;
 
     // Main loop
     // ========================================
     while (!quit) {
 
-        uint64_t t1 = get_performance_counter();
-        float elapsed_ms = (t1 - t) / (float)(t_freq) * 1000.0f;
-        printf("Frame time: %f ms\n", elapsed_ms);
-        t = t1;
-
-
         // Update game state
         // ========================================
-        SDL_GetMouseState(&mouse_x, &mouse_y);
+        profiler_begin(PROFILE_UPDATE);
+        if (bench_frames > 0) {
+            bench_input(frame, &game, card_width, card_height,
+                    &mouse_x, &mouse_y, &mouse_just_pressed, &mouse_just_released);
+        } else {
+            SDL_GetMouseState(&mouse_x, &mouse_y);
+        }
 
+        // Location under the mouse, and for columns the card under it
+        int active;
+        int active_card = 0;
         if (mouse_y > card_height) {
             // We're in the main piles
-            int active_pile = mouse_x / card_width;
-            int pile_size = 0;
-            while (piles[active_pile][pile_size].suit != SUIT_NONE) pile_size += 1;
-            int active_card = (mouse_y - card_height) / STACKING_OFFSET;
+            active = FIRST_COLUMN + mouse_x / card_width;
+            int pile_size = game.column_len[active];
+            active_card = (mouse_y - card_height) / STACKING_OFFSET;
             active_card = active_card > pile_size - 1 ? pile_size - 1 : active_card;
+        } else if (mouse_x < card_width * 4) {
+            // We're in the free cells
+            active = FIRST_FREE_CELL + mouse_x / card_width;
+        } else {
+            // We're in the destination cells
+            active = FIRST_FOUNDATION + (mouse_x - get_screen_width() / 2) / card_width;
+        }
 
-            if (mouse_just_released) {
-                mouse_just_released = false;
-
-                // Check if we can legally place this card on the current stack
-                bool can_place = true;
-                int i = 1;
-                while (piles[active_pile][i].suit != SUIT_NONE) i += 1;
-                Card dest = piles[active_pile][i - 1];
-                Card src = held_pile[0];
-
-                if (src.suit / 3 == dest.suit / 3) can_place = false;
-                if (src.rank != dest.rank - 1) can_place = false;
-                if (dest.suit == SUIT_NONE) can_place = true;
-
-                // Put held cards back onto the last pile
-                int start = 0;
-                int target_pile = can_place ? active_pile : last_active_pile;
-                if (target_pile >= 8) {
-                    free_cells[target_pile - 8] = held_pile[0];
-                    held_pile[0] = CARD_NONE;
-                } else {
-                    while (piles[target_pile][start].suit != SUIT_NONE) {
-                        start += 1;
-                    }
-                    for (int i = 0; held_pile[i].suit != SUIT_NONE; i++) {
-                        piles[target_pile][start + i] = held_pile[i];
-                        held_pile[i] = CARD_NONE;
-                    }
-                }
+        if (auto_solving || replaying) {
+            // A move is applied once it has slid into place, and the next
+            // one starts the same frame if it is ready. Fast enough, several
+            // land in one frame.
+            if (anim_frame >= 0) {
+                anim_frame += speed;
             }
-
-            // TODO Move mouse_just_pressed higher so this doesn't get
-            // triggered by dragging the mouse into the target zone
-            if (mouse_just_pressed) {
-                mouse_just_pressed = false;
-
-                bool can_pick_up = true;
-                int len = 0;
-                for (int i = active_card; piles[active_pile][i].suit != SUIT_NONE; i++) len += 1;
-                if (len > 1) {
-                    for (int i = active_card; i < active_card + len - 1; i++) {
-                        Card this = piles[active_pile][i];
-                        Card next = piles[active_pile][i + 1];
-                        if (next.suit / 3 == this.suit / 3) can_pick_up = false;
-                        if (next.rank != this.rank - 1) can_pick_up = false;
-                    }
+            while (anim_frame < 0 || anim_frame >= AUTO_MOVE_FRAMES) {
+                if (anim_frame >= 0) {
+                    apply_move(&game, anim_move);
+                    replay_record(&replay, anim_move);
+                    anim_frame -= AUTO_MOVE_FRAMES;
                 }
-
-                if (can_pick_up) {
-                    for (int i = active_card; piles[active_pile][i].suit != SUIT_NONE; i++) {
-                        held_pile[i - active_card] = piles[active_pile][i];
-                        piles[active_pile][i] = CARD_NONE;
-                    }
+                bool next = replaying
+                    ? replay_next(&playback, &playback_pos, &anim_move)
+                    : move_queue_pop(&auto_solver.queue, &anim_move);
+                if (next && replaying && !can_move(&game, anim_move)) {
+                    printf("Replay move %d is illegal\n", replay.header.num_moves + 1);
+                    next = false;
                 }
-                last_active_pile = active_pile; // TODO does this go in the if (can_pick_up) or not?
-            }
-
-        } else if (mouse_x < card_width * 4) {
-            // We're in the free cells
-            int active = mouse_x / card_width;
-            if (mouse_just_pressed) {
-                mouse_just_pressed = false;
-                if (free_cells[active].suit != SUIT_NONE) {
-                    held_pile[0] = free_cells[active];
-                    free_cells[active] = CARD_NONE;
+                if (!next) {
+                    anim_frame = -1;
+                    break;
                 }
-                last_active_pile = active + 8;
+                anim_frame = anim_frame < 0 ? 0 : anim_frame;
             }
-            if (mouse_just_released) {
-                mouse_just_released = false;
-                if (free_cells[active].suit == SUIT_NONE && pile_len(held_pile) == 1) {
-                    free_cells[active] = held_pile[0];
-                    held_pile[0] = CARD_NONE;
+            if (anim_frame < 0 && replaying) {
+                replaying = false;
+            } else if (anim_frame < 0 && atomic_load(&auto_solver.done)) {
+                auto_solve_join(&auto_solver);
+                auto_solving = false;
+                if (auto_solver.status != SOLVE_SOLVED) {
+                    printf("Auto-solve: %s\n", solve_status_name(auto_solver.status));
                 }
             }
+            mouse_just_pressed = false;
+            mouse_just_released = false;
+        }
 
-        } else {
-            // We're in the destination cells
-            int active = (mouse_x - get_screen_width() / 2) / card_width;
-
-            // TODO we maybe don't need this because we can't move cards out of
-            // the destination cells, but should we have it here anyway to
-            // maintain the correct mouse state?
-            if (mouse_just_pressed) {
-                mouse_just_pressed = false;
+        if (mouse_just_released) {
+            mouse_just_released = false;
+
+            // Cards that can't go here stay where they were picked up from.
+            // Anything that can safely go home afterwards does.
+            Move move = { held_from, active, held_count };
+            if (held_count > 0 && can_move(&game, move)) {
+                apply_move(&game, move);
+                replay_record(&replay, move);
+                Move safe[52];
+                int num_safe = auto_moves(&game, safe);
+                for (int i = 0; i < num_safe; i++) {
+                    replay_record(&replay, safe[i]);
+                }
             }
+            held_count = 0;
+        }
 
-            if (mouse_just_released) {
-                mouse_just_released = false;
+        // TODO Move mouse_just_pressed higher so this doesn't get
+        // triggered by dragging the mouse into the target zone
+        if (mouse_just_pressed) {
+            mouse_just_pressed = false;
 
-                bool can_place = false;
-                if (pile_len(held_pile) == 1) {
-                    can_place = true;
-                    if (destination_cells[active].suit != SUIT_NONE &&
-                            destination_cells[active].suit != held_pile[0].suit) {
-                        can_place = false;
-                    }
-                    if (destination_cells[active].rank != held_pile[0].rank - 1) {
-                        can_place = false;
-                    }
-                }
+            int count = location_len(&game, active) - active_card;
+            if (active >= FIRST_FREE_CELL) {
+                count = 1;
+            }
+            if (can_pick_up(&game, active, count)) {
+                held_from = active;
+                held_count = count;
+            }
+        }
 
-                if (can_place) {
-                    destination_cells[active] = held_pile[0];
-                    held_pile[0] = CARD_NONE;
-                } else {
-                    if (last_active_pile >= 8) {
-                        free_cells[last_active_pile - 8] = held_pile[0];
-                        held_pile[0] = CARD_NONE;
-                    } else {
-                        int start = 0;
-                        while (piles[last_active_pile][start].suit != SUIT_NONE) {
-                            start += 1;
-                        }
-                        for (int i = 0; held_pile[i].suit != SUIT_NONE; i++) {
-                            piles[last_active_pile][start + i] = held_pile[i];
-                            held_pile[i] = CARD_NONE;
-                        }
-                    }
-                }
+        // Cards being dragged are still in place in game, so any frame is a
+        // good time to save
+        if (save_path && get_performance_counter() - last_save
+                >= SNAPSHOT_INTERVAL_SECONDS * t_freq) {
+            if (memcmp(&game, &snapshot.game, sizeof(game)) != 0) {
+                memset(&snapshot, 0, sizeof(snapshot));
+                snapshot.deal = replay.header.seed;
+                snapshot.game = game;
+                snapshot_save(save_path, &snapshot);
             }
+            last_save = get_performance_counter();
         }
 
+        profiler_end(PROFILE_UPDATE);
+
         // Handle events
         // ========================================
-        while (SDL_PollEvent(&event)) {
+        profiler_begin(PROFILE_EVENTS);
+        bool stop_auto_solve = false;
+        while (bench_frames == 0 && SDL_PollEvent(&event)) {
             switch (event.type) {
                 case SDL_QUIT:
                     quit = true;
@@ -348,6 +534,7 @@ int main(int argc, char **argv) {
                 case SDL_MOUSEBUTTONDOWN:
                 case SDL_FINGERDOWN:
                     mouse_just_pressed = true;
+                    stop_auto_solve = auto_solving || replaying;
                     break;
                 case SDL_MOUSEBUTTONUP:
                 case SDL_FINGERUP:
@@ -356,95 +543,184 @@ int main(int argc, char **argv) {
                 case SDL_KEYDOWN:
                     {
                         SDL_Keycode code = event.key.keysym.sym;
+                        if (auto_solving || replaying) {
+                            stop_auto_solve = true;
+                            break;
+                        }
                         switch (code) {
                             case SDLK_q:
                                 quit = true;
                                 break;
+                            case SDLK_p:
+                                show_profiler = !show_profiler;
+                                break;
+                            case SDLK_n:
+                                next_replay(&replay, recording ? record_path : NULL,
+                                        new_game(&game, &db, db_filter, difficulty));
+                                recording = true;
+                                held_count = 0;
+                                break;
+                            case SDLK_a:
+                                // A cancelled solve still winding down is
+                                // left to finish first
+                                if (!auto_solver.thread) {
+                                    held_count = 0;
+                                    auto_solving = auto_solve_start(&auto_solver, &game);
+                                }
+                                break;
                         }
                     }
                     break;
             }
         }
 
+        if (stop_auto_solve) {
+            // Finish the move in flight so the table is left consistent.
+            // The worker is joined once it notices.
+            auto_solve_cancel(&auto_solver);
+            if (anim_frame >= 0) {
+                apply_move(&game, anim_move);
+                replay_record(&replay, anim_move);
+                anim_frame = -1;
+            }
+            auto_solving = false;
+            replaying = false;
+            mouse_just_pressed = false;
+        }
+        if (!auto_solving && auto_solver.thread && atomic_load(&auto_solver.done)) {
+            auto_solve_join(&auto_solver);
+        }
+
+        profiler_end(PROFILE_EVENTS);
+
         // Draw
         // ========================================
+        profiler_begin(PROFILE_DRAW);
         clear_screen(64, 128, 64, 255);
 
         Card cards_to_draw[52];
         Rect rects_to_draw[52];
         int count = 0;
 
-        for (int i = 0; i < 4; i++) {
-            if (free_cells[i].suit != SUIT_NONE) {
-                Rect rect = {
-                    i * card_width + 1,
-                    1,
-                    card_width - 2,
-                    card_height - 2,
-                };
-                /* draw_card(free_cells[i], rect); */
-                cards_to_draw[count] = free_cells[i];
-                rects_to_draw[count] = rect;
+        // Cards sliding into place are left out of their source and drawn
+        // on top, like held cards
+        int anim_count = anim_frame >= 0 ? anim_move.count : 0;
+        int hidden_from = held_count > 0 ? held_from : anim_move.from;
+        int hidden_count = held_count > 0 ? held_count : anim_count;
+
+        for (int i = 0; i < NUM_FREE_CELLS; i++) {
+            bool hidden = hidden_count > 0 && hidden_from == FIRST_FREE_CELL + i;
+            if (game.free_cells[i].suit != SUIT_NONE && !hidden) {
+                cards_to_draw[count] = game.free_cells[i];
+                rects_to_draw[count] = card_rect(FIRST_FREE_CELL + i, 0, card_width, card_height);
                 count++;
             }
         }
 
-        for (int i = 0; i < 4; i++) {
-            if (destination_cells[i].suit != SUIT_NONE) {
-                Rect rect = {
-                    (i + 4) * card_width + 1,
-                    1,
-                    card_width - 2,
-                    card_height - 2,
-                };
-                cards_to_draw[count] = destination_cells[i];
-                rects_to_draw[count] = rect;
+        for (int i = 0; i < NUM_FOUNDATIONS; i++) {
+            if (game.destination_cells[i].suit != SUIT_NONE) {
+                cards_to_draw[count] = game.destination_cells[i];
+                rects_to_draw[count] = card_rect(FIRST_FOUNDATION + i, 0, card_width, card_height);
                 count++;
             }
         }
 
-        for (int x = 0; x < MAIN_PILE_COUNT; x++) {
-            for (int y = 0; y < 52; y++) {
-                if (piles[x][y].suit == SUIT_NONE) {
-                    break;
-                }
-                Rect rect = {
-                    x * card_width + 1,
-                    card_height + y * STACKING_OFFSET + 1,
-                    card_width - 2,
-                    card_height - 2,
-                };
-                /* draw_card(piles[x][y], rect); */
-                cards_to_draw[count] = piles[x][y];
-                rects_to_draw[count] = rect;
+        Card *pile = game.cards;
+        for (int x = 0; x < NUM_COLUMNS; x++) {
+            int len = game.column_len[x];
+            Card *column = pile;
+            pile += len;
+            if (hidden_count > 0 && hidden_from == x) {
+                len -= hidden_count;
+            }
+            for (int y = 0; y < len; y++) {
+                cards_to_draw[count] = column[y];
+                rects_to_draw[count] = card_rect(x, y, card_width, card_height);
                 count++;
             }
         }
 
-        /* draw_cards(cards_to_draw, rects_to_draw, count); */
-        for (int i = 0; i < count; i++) {
-            draw_card(cards_to_draw[i], rects_to_draw[i]);
-        }
-
-        // TODO cards don't really overlap properly right now because draw_cards draws all the fronts then all the suits/text. Just drawing the held card separately after all the others works in this case, but a more generalized solution will require different rendering logic.
-        for (int i = 0; i < 52; i++) {
-            if (held_pile[i].suit == SUIT_NONE) {
-                break;
-            }
+        // Held cards go last so they are drawn over everything else
+        int held_base = location_len(&game, held_from) - held_count;
+        for (int i = 0; i < held_count; i++) {
             Rect rect = {
                 mouse_x - mouse_offset_x + 1,
                 mouse_y + i * STACKING_OFFSET - mouse_offset_y + 1,
                 card_width - 2,
                 card_height - 2,
             };
-            draw_card(held_pile[i], rect);
-            /* cards_to_draw[count] = held_pile[i]; */
-            /* rects_to_draw[count] = rect; */
-            /* count++; */
+            cards_to_draw[count] = location_card(&game, held_from, held_base + i);
+            rects_to_draw[count] = rect;
+            count++;
+        }
+
+        int anim_base = location_len(&game, anim_move.from) - anim_count;
+        int anim_dest = location_len(&game, anim_move.to);
+        float t = anim_frame / AUTO_MOVE_FRAMES;
+        for (int i = 0; i < anim_count; i++) {
+            Rect from = card_rect(anim_move.from, anim_base + i, card_width, card_height);
+            Rect to = card_rect(anim_move.to, anim_dest + i, card_width, card_height);
+            from.x += (to.x - from.x) * t;
+            from.y += (to.y - from.y) * t;
+            cards_to_draw[count] = location_card(&game, anim_move.from, anim_base + i);
+            rects_to_draw[count] = from;
+            count++;
+        }
+
+        draw_cards(cards_to_draw, rects_to_draw, count);
+
+        // Shown from the frame the solve starts, before any move comes back
+        if (auto_solving && anim_frame < 0) {
+            draw_text(font, 8, get_screen_height() - 32, 24.0f,
+                    (Color){255, 255, 255, 255}, "Solving...");
+        }
+
+        if (show_profiler) {
+            profiler_draw(font, 8, get_screen_height() - 120);
         }
+        profiler_end(PROFILE_DRAW);
 
+        profiler_begin(PROFILE_SWAP);
         graphics_swap();
+        profiler_end(PROFILE_SWAP);
+        profiler_end_frame();
+
+        frame++;
+        if (bench_frames > 0) {
+            FrameStats stats = get_frame_stats();
+            bench_draw_calls += stats.draw_calls;
+            bench_uploads += stats.uploads;
+            if (frame == bench_frames) {
+                quit = true;
+            }
+        }
     }
 
+    if (bench_frames > 0) {
+        float seconds = (get_performance_counter() - bench_start) / (float)t_freq;
+        printf("%d frames in %.3f s: %.1f fps, %.3f ms/frame\n",
+                frame, seconds, frame / seconds, seconds * 1000.0f / frame);
+        printf("%.1f draw calls/frame, %.1f buffer uploads/frame\n",
+                bench_draw_calls / (float)frame, bench_uploads / (float)frame);
+        profiler_print();
+    }
+
+    auto_solve_cancel(&auto_solver);
+    auto_solve_join(&auto_solver);
+    if (save_path) {
+        memset(&snapshot, 0, sizeof(snapshot));
+        snapshot.deal = replay.header.seed;
+        snapshot.game = game;
+        if (!snapshot_save(save_path, &snapshot)) {
+            printf("Couldn't save the game to %s\n", save_path);
+        }
+        SDL_free(save_path);
+    }
+    next_replay(&replay, recording ? record_path : NULL, 0);
+    replay_free(&replay);
+    replay_free(&playback);
+    dealdb_close(&db);
+    profiler_free();
+    free_font(font);
     graphics_free();
 }
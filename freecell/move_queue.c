@@ -0,0 +1,30 @@
+#include "move_queue.h"
+
+void move_queue_init(MoveQueue *queue) {
+    atomic_init(&queue->head, 0);
+    atomic_init(&queue->tail, 0);
+}
+
+// Producer only. The release store publishes the move before the new tail.
+bool move_queue_push(MoveQueue *queue, Move move) {
+    unsigned tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    unsigned head = atomic_load_explicit(&queue->head, memory_order_acquire);
+    if (tail - head == MOVE_QUEUE_SIZE) {
+        return false;
+    }
+    queue->moves[tail & (MOVE_QUEUE_SIZE - 1)] = move;
+    atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+    return true;
+}
+
+// Consumer only. The slot is read before the new head hands it back.
+bool move_queue_pop(MoveQueue *queue, Move *move) {
+    unsigned head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+    if (head == tail) {
+        return false;
+    }
+    *move = queue->moves[head & (MOVE_QUEUE_SIZE - 1)];
+    atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+    return true;
+}
@@ -0,0 +1,25 @@
+#ifndef MOVE_QUEUE_H
+#define MOVE_QUEUE_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+
+#include "rules.h"
+
+// Lock-free queue of moves from one producer thread to one consumer thread.
+// Neither side ever waits on the other: push fails when the queue is full
+// and pop when it is empty.
+
+#define MOVE_QUEUE_SIZE 256 // Must be a power of two
+
+typedef struct {
+    Move moves[MOVE_QUEUE_SIZE];
+    atomic_uint head; // Next slot to read, only written by the consumer
+    atomic_uint tail; // Next slot to write, only written by the producer
+} MoveQueue;
+
+void move_queue_init(MoveQueue *queue);
+bool move_queue_push(MoveQueue *queue, Move move);
+bool move_queue_pop(MoveQueue *queue, Move *move);
+
+#endif // MOVE_QUEUE_H
@@ -0,0 +1,131 @@
+#include <stdint.h>
+
+#include "profiler.h"
+#include "timer.h"
+
+// GPU timings are read this many frames after they were issued, by which
+// time the GPU has almost always finished them and reading doesn't stall
+#define PROFILER_LATENCY 4
+
+// One set of queries per frame in flight, plus the one being issued
+#define PROFILER_SLOTS (PROFILER_LATENCY + 1)
+
+// Weight of the newest sample in the displayed averages
+#define PROFILER_SMOOTHING 0.1f
+
+static char *ZONE_NAMES[PROFILE_ZONE_COUNT] = { "update", "events", "draw", "swap" };
+
+static struct {
+    GLuint queries[PROFILER_SLOTS][PROFILE_ZONE_COUNT];
+    // Issued and not yet read back, and on which frame
+    bool pending[PROFILER_SLOTS][PROFILE_ZONE_COUNT];
+    int issued[PROFILER_SLOTS][PROFILE_ZONE_COUNT];
+    // Whether this frame's zone has a query running
+    bool active[PROFILE_ZONE_COUNT];
+    uint64_t cpu_start[PROFILE_ZONE_COUNT];
+    float cpu_ms[PROFILE_ZONE_COUNT];
+    float gpu_ms[PROFILE_ZONE_COUNT];
+    uint64_t frame_start;
+    float frame_ms;
+    int frame;
+} profiler;
+
+static float smooth(float average, float sample) {
+    return average + (sample - average) * PROFILER_SMOOTHING;
+}
+
+static float ms_since(uint64_t start) {
+    return (get_performance_counter() - start) * 1000.0f / (float)get_performance_frequency();
+}
+
+void profiler_init() {
+    glGenQueries(PROFILER_SLOTS * PROFILE_ZONE_COUNT, &profiler.queries[0][0]);
+    profiler.frame_start = get_performance_counter();
+}
+
+void profiler_free() {
+    glDeleteQueries(PROFILER_SLOTS * PROFILE_ZONE_COUNT, &profiler.queries[0][0]);
+}
+
+// Zones must not overlap: only one GL_TIME_ELAPSED query can be active.
+// A query whose last result the GPU still hasn't delivered is left alone,
+// and the zone goes without a GPU sample this frame.
+void profiler_begin(ProfileZone zone) {
+    profiler.cpu_start[zone] = get_performance_counter();
+    int slot = profiler.frame % PROFILER_SLOTS;
+    profiler.active[zone] = !profiler.pending[slot][zone];
+    if (profiler.active[zone]) {
+        glBeginQuery(GL_TIME_ELAPSED, profiler.queries[slot][zone]);
+    }
+}
+
+void profiler_end(ProfileZone zone) {
+    if (profiler.active[zone]) {
+        glEndQuery(GL_TIME_ELAPSED);
+        int slot = profiler.frame % PROFILER_SLOTS;
+        profiler.pending[slot][zone] = true;
+        profiler.issued[slot][zone] = profiler.frame;
+        profiler.active[zone] = false;
+    }
+    profiler.cpu_ms[zone] = smooth(profiler.cpu_ms[zone], ms_since(profiler.cpu_start[zone]));
+}
+
+void profiler_end_frame() {
+    uint64_t now = get_performance_counter();
+    float frame_ms = (now - profiler.frame_start) * 1000.0f / (float)get_performance_frequency();
+    profiler.frame_ms = smooth(profiler.frame_ms, frame_ms);
+    profiler.frame_start = now;
+
+    // Collect queries at least PROFILER_LATENCY frames old. One whose result
+    // still isn't ready stays pending and is tried again next frame, rather
+    // than waited on or dropped.
+    for (int slot = 0; slot < PROFILER_SLOTS; slot++) {
+        for (int zone = 0; zone < PROFILE_ZONE_COUNT; zone++) {
+            if (!profiler.pending[slot][zone]
+                    || profiler.frame - profiler.issued[slot][zone] < PROFILER_LATENCY) {
+                continue;
+            }
+            GLuint query = profiler.queries[slot][zone];
+            GLint available = 0;
+            glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+            if (available) {
+                GLuint64 ns = 0;
+                glGetQueryObjectui64v(query, GL_QUERY_RESULT, &ns);
+                profiler.gpu_ms[zone] = smooth(profiler.gpu_ms[zone], ns / 1000000.0f);
+                profiler.pending[slot][zone] = false;
+            }
+        }
+    }
+    profiler.frame++;
+}
+
+void profiler_draw(Font font, int x, int y) {
+    float size = 14.0f;
+    int line_height = 16;
+    Color color = {255, 255, 255, 255};
+    char line[64];
+
+    draw_rect((Rect){x, y, 200, line_height * (PROFILE_ZONE_COUNT + 2) + 8}, (Color){0, 0, 0, 160});
+    x += 4;
+    y += 4;
+
+    snprintf(line, sizeof(line), "frame %6.2f ms", profiler.frame_ms);
+    draw_text(font, x, y, size, color, line);
+    y += line_height;
+    draw_text(font, x, y, size, color, "zone      cpu ms   gpu ms");
+    y += line_height;
+    for (int zone = 0; zone < PROFILE_ZONE_COUNT; zone++) {
+        snprintf(line, sizeof(line), "%-8s %7.2f  %7.2f",
+                ZONE_NAMES[zone], profiler.cpu_ms[zone], profiler.gpu_ms[zone]);
+        draw_text(font, x, y, size, color, line);
+        y += line_height;
+    }
+}
+
+void profiler_print() {
+    printf("frame %.3f ms\n", profiler.frame_ms);
+    for (int zone = 0; zone < PROFILE_ZONE_COUNT; zone++) {
+        printf("%-8s cpu %.3f ms, gpu %.3f ms\n",
+                ZONE_NAMES[zone], profiler.cpu_ms[zone], profiler.gpu_ms[zone]);
+    }
+}
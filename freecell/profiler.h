@@ -0,0 +1,22 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include "graphics.h"
+
+typedef enum {
+    PROFILE_UPDATE,
+    PROFILE_EVENTS,
+    PROFILE_DRAW,
+    PROFILE_SWAP,
+    PROFILE_ZONE_COUNT,
+} ProfileZone;
+
+void profiler_init();
+void profiler_free();
+void profiler_begin(ProfileZone zone);
+void profiler_end(ProfileZone zone);
+void profiler_end_frame();
+void profiler_draw(Font font, int x, int y);
+void profiler_print();
+
+#endif // PROFILER_H
@@ -0,0 +1,16 @@
+#include "replay.h"
+
+void replay_record(Replay *replay, Move move) {
+    replay_record_value(replay, (move.from & 0xf) | (move.to & 0xf) << 4 | (move.count - 1) << 8);
+}
+
+// Decodes the move at *pos and steps past it. False once the moves run out
+// or if the last one is cut short.
+bool replay_next(Replay *replay, size_t *pos, Move *move) {
+    uint32_t value;
+    if (!replay_next_value(replay, pos, &value)) {
+        return false;
+    }
+    *move = (Move){ value & 0xf, value >> 4 & 0xf, (value >> 8) + 1 };
+    return true;
+}
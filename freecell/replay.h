@@ -0,0 +1,14 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "../common/replay_format.h"
+#include "rules.h"
+
+// FreeCell's moves in the replay format shared with Spider (see
+// common/replay_format.h), each packed as from | to << 4 | (count - 1) << 8,
+// so most take one or two bytes.
+
+void replay_record(Replay *replay, Move move);
+bool replay_next(Replay *replay, size_t *pos, Move *move);
+
+#endif // REPLAY_H
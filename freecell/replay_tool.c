@@ -0,0 +1,125 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "replay.h"
+#include "rules.h"
+#include "timer.h"
+
+static void usage() {
+    printf("usage: freecell-replay [--quiet] [--repeat N] FILE\n");
+    printf("Plays every game in FILE back through the rules, checking each move, and reports\n");
+    printf("how it ended. --repeat plays them N times over, for timing.\n");
+}
+
+typedef enum { PLAYBACK_WON, PLAYBACK_UNFINISHED, PLAYBACK_ILLEGAL } PlaybackResult;
+
+static const char *playback_result_name(PlaybackResult result) {
+    switch (result) {
+        case PLAYBACK_WON: return "won";
+        case PLAYBACK_UNFINISHED: return "unfinished";
+        case PLAYBACK_ILLEGAL: return "illegal";
+    }
+    return "?";
+}
+
+// Plays the game from its deal, stopping at the first move the rules don't
+// allow. *played is how many moves were made.
+static PlaybackResult play(Replay *replay, uint32_t *played) {
+    GameState game;
+    deal_from_number(&game, replay->header.seed);
+    size_t pos = 0;
+    Move move;
+    *played = 0;
+    while (replay_next(replay, &pos, &move)) {
+        if (!can_move(&game, move)) {
+            return PLAYBACK_ILLEGAL;
+        }
+        apply_move(&game, move);
+        (*played)++;
+    }
+    if (*played != replay->header.num_moves) {
+        return PLAYBACK_ILLEGAL;
+    }
+    return game_won(&game) ? PLAYBACK_WON : PLAYBACK_UNFINISHED;
+}
+
+int main(int argc, char **argv) {
+    bool quiet = false;
+    long repeat = 1;
+    const char *path = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--quiet") == 0) {
+            quiet = true;
+        } else if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+            repeat = atol(argv[++i]);
+        } else if (argv[i][0] != '-' && !path) {
+            path = argv[i];
+        } else {
+            usage();
+            return 1;
+        }
+    }
+    if (!path || repeat < 1) {
+        usage();
+        return 1;
+    }
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "couldn't open %s\n", path);
+        return 1;
+    }
+
+    // Every game is read into memory first so that only playback is timed
+    Replay *games = NULL;
+    int num_games = 0;
+    int status;
+    for (;;) {
+        games = realloc(games, (num_games + 1) * sizeof(Replay));
+        memset(&games[num_games], 0, sizeof(Replay));
+        status = replay_read(&games[num_games], f);
+        if (status <= 0) {
+            break;
+        }
+        num_games++;
+    }
+    replay_free(&games[num_games]);
+    fclose(f);
+    if (status < 0) {
+        fprintf(stderr, "%s: game %d is not a replay\n", path, num_games + 1);
+    }
+
+    int bad = 0;
+    long total_moves = 0;
+    uint64_t t = get_performance_counter();
+    for (long r = 0; r < repeat; r++) {
+        for (int i = 0; i < num_games; i++) {
+            Replay *replay = &games[i];
+            if (replay->header.variant != REPLAY_FREECELL) {
+                if (r == 0 && !quiet) {
+                    printf("%d skipped, not a FreeCell game\n", i + 1);
+                }
+                continue;
+            }
+            uint32_t played;
+            PlaybackResult result = play(replay, &played);
+            total_moves += played;
+            if (r == 0) {
+                bad += result == PLAYBACK_ILLEGAL;
+                if (!quiet || result == PLAYBACK_ILLEGAL) {
+                    printf("%d deal=%u %s moves=%u/%u\n", i + 1, replay->header.seed,
+                            playback_result_name(result), played, replay->header.num_moves);
+                }
+            }
+        }
+    }
+    double seconds = (get_performance_counter() - t) / (double)get_performance_frequency();
+
+    fprintf(stderr, "%d games, %ld moves in %.3f s, %.0f moves/s\n", num_games, total_moves,
+            seconds, seconds > 0 ? total_moves / seconds : 0.0);
+    for (int i = 0; i < num_games; i++) {
+        replay_free(&games[i]);
+    }
+    free(games);
+    return bad > 0 || status < 0 ? 2 : 0;
+}
@@ -0,0 +1,382 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "rules.h"
+
+const Card CARD_NONE = {0};
+
+// Black suits (spades, clubs) are 0, red suits (hearts, diamonds) are 1
+int card_color(Card card) {
+    return card.suit / 3;
+}
+
+// The bottom card of a column, with the rest above it
+Card *column_cards(GameState *game, int column) {
+    int start = 0;
+    for (int i = 0; i < column; i++) {
+        start += game->column_len[i];
+    }
+    return &game->cards[start];
+}
+
+void make_deck(Card deck[52]) {
+    for (int suit = 0; suit < 4; suit++) {
+        for (int rank = 0; rank < 13; rank++) {
+            deck[suit * 13 + rank] = (Card){rank + 1, suit + 1};
+        }
+    }
+}
+
+void shuffle(Card deck[], int num_cards) {
+    if (num_cards > 1) {
+        for (int i = 0; i < num_cards - 1; i++) {
+            int j = i + rand() / (RAND_MAX / (num_cards - i) + 1);
+            Card card = deck[j];
+            deck[j] = deck[i];
+            deck[i] = card;
+        }
+    }
+}
+
+// Deals the deck out left to right, row by row
+void game_deal(GameState *game, Card deck[52]) {
+    memset(game, 0, sizeof(*game));
+    int n = 0;
+    for (int column = 0; column < NUM_COLUMNS; column++) {
+        for (int i = column; i < 52; i += NUM_COLUMNS) {
+            game->cards[n++] = deck[i];
+            game->column_len[column]++;
+        }
+    }
+}
+
+// The numbered deals of Microsoft FreeCell, which shuffle with the
+// Microsoft C runtime's rand() seeded with the deal number
+void deal_from_number(GameState *game, uint32_t number) {
+    // Cards 0-51 run A-K with suits interleaved as clubs, diamonds, hearts,
+    // spades
+    static const Suit MS_SUITS[4] = { SUIT_CLUB, SUIT_DIAMOND, SUIT_HEART, SUIT_SPADE };
+    int order[52];
+    for (int i = 0; i < 52; i++) {
+        order[i] = 51 - i;
+    }
+    uint32_t seed = number;
+    for (int i = 0; i < 52; i++) {
+        seed = (seed * 214013 + 2531011) & 0x7fffffff;
+        int r = (seed >> 16) & 0x7fff;
+        int j = 51 - r % (52 - i);
+        int card = order[i];
+        order[i] = order[j];
+        order[j] = card;
+    }
+
+    Card deck[52];
+    for (int i = 0; i < 52; i++) {
+        deck[i] = (Card){ order[i] / 4 + 1, MS_SUITS[order[i] % 4] };
+    }
+    game_deal(game, deck);
+}
+
+int location_len(GameState *game, int location) {
+    if (location < FIRST_FREE_CELL) {
+        return game->column_len[location];
+    } else if (location < FIRST_FOUNDATION) {
+        return game->free_cells[location - FIRST_FREE_CELL].suit != SUIT_NONE;
+    } else {
+        return game->destination_cells[location - FIRST_FOUNDATION].rank;
+    }
+}
+
+// The card at idx counting up from the bottom. Foundations can only be read
+// at the top.
+Card location_card(GameState *game, int location, int idx) {
+    if (location < FIRST_FREE_CELL) {
+        return column_cards(game, location)[idx];
+    } else if (location < FIRST_FOUNDATION) {
+        return game->free_cells[location - FIRST_FREE_CELL];
+    } else {
+        return game->destination_cells[location - FIRST_FOUNDATION];
+    }
+}
+
+// The longest run that can be moved at once, which is as many cards as could
+// be moved one at a time through the empty free cells and columns:
+// (free cells + 1) * 2^(empty columns). An empty destination column can't
+// also be used as temporary space; legal_moves asks for that capacity even
+// when no column is empty, and gets the capacity without one.
+int move_capacity(GameState *game, bool to_empty_column) {
+    int free_cells = 0;
+    for (int i = 0; i < NUM_FREE_CELLS; i++) {
+        free_cells += game->free_cells[i].suit == SUIT_NONE;
+    }
+    int empty_columns = 0;
+    for (int i = 0; i < NUM_COLUMNS; i++) {
+        empty_columns += game->column_len[i] == 0;
+    }
+    if (to_empty_column && empty_columns > 0) {
+        empty_columns--;
+    }
+    return (free_cells + 1) << empty_columns;
+}
+
+// Whether the top count cards of a location can be lifted together
+bool can_pick_up(GameState *game, int from, int count) {
+    if (from >= FIRST_FOUNDATION || count < 1 || count > location_len(game, from)) {
+        return false;
+    }
+    if (from >= FIRST_FREE_CELL) {
+        return count == 1;
+    }
+    // A run must alternate colours and descend by one
+    Card *pile = column_cards(game, from);
+    int len = game->column_len[from];
+    for (int i = len - count; i < len - 1; i++) {
+        Card this = pile[i];
+        Card next = pile[i + 1];
+        if (card_color(next) == card_color(this)) return false;
+        if (next.rank != this.rank - 1) return false;
+    }
+    return true;
+}
+
+bool can_move(GameState *game, Move move) {
+    if (move.from == move.to || move.to >= NUM_LOCATIONS) {
+        return false;
+    }
+    if (!can_pick_up(game, move.from, move.count)) {
+        return false;
+    }
+    Card src = location_card(game, move.from, location_len(game, move.from) - move.count);
+
+    if (move.to < FIRST_FREE_CELL) {
+        int len = game->column_len[move.to];
+        if (move.count > 1 && move.count > move_capacity(game, len == 0)) {
+            return false;
+        }
+        if (len == 0) {
+            return true;
+        }
+        Card dest = column_cards(game, move.to)[len - 1];
+        return card_color(src) != card_color(dest) && src.rank == dest.rank - 1;
+    } else if (move.to < FIRST_FOUNDATION) {
+        return move.count == 1 && game->free_cells[move.to - FIRST_FREE_CELL].suit == SUIT_NONE;
+    } else {
+        Card dest = game->destination_cells[move.to - FIRST_FOUNDATION];
+        if (move.count != 1) {
+            return false;
+        }
+        if (dest.suit != SUIT_NONE && dest.suit != src.suit) {
+            return false;
+        }
+        return src.rank == dest.rank + 1;
+    }
+}
+
+// Length of the run at the top of a column that could be picked up together
+static int run_len(Card pile[], int len) {
+    if (len == 0) {
+        return 0;
+    }
+    int run = 1;
+    while (run < len) {
+        Card this = pile[len - run - 1];
+        Card next = pile[len - run];
+        if (card_color(next) == card_color(this) || next.rank != this.rank - 1) break;
+        run++;
+    }
+    return run;
+}
+
+int legal_moves(GameState *game, Move moves[]) {
+    int n = 0;
+    int capacity = move_capacity(game, false);
+    int capacity_empty = move_capacity(game, true);
+
+    // Where each column starts, and its top card
+    Card *columns[NUM_COLUMNS];
+    Card tops[NUM_COLUMNS];
+    Card *pile = game->cards;
+    for (int i = 0; i < NUM_COLUMNS; i++) {
+        columns[i] = pile;
+        pile += game->column_len[i];
+        tops[i] = game->column_len[i] > 0 ? pile[-1] : CARD_NONE;
+    }
+
+    for (int from = 0; from < FIRST_FOUNDATION; from++) {
+        int len = location_len(game, from);
+        if (len == 0) {
+            continue;
+        }
+        Card *cards = from < FIRST_FREE_CELL ? columns[from] : &game->free_cells[from - FIRST_FREE_CELL];
+        int run = from < FIRST_FREE_CELL ? run_len(cards, len) : 1;
+        Card top = cards[len - 1];
+
+        for (int to = 0; to < NUM_LOCATIONS; to++) {
+            if (to == from) {
+                continue;
+            }
+            if (to < FIRST_FREE_CELL) {
+                if (game->column_len[to] == 0) {
+                    int max = run < capacity_empty ? run : capacity_empty;
+                    for (int count = 1; count <= max; count++) {
+                        moves[n++] = (Move){ from, to, count };
+                    }
+                    continue;
+                }
+                // Only one length of run can fit on a given card
+                Card dest = tops[to];
+                int count = dest.rank - top.rank;
+                if (count >= 1 && count <= run && (count == 1 || count <= capacity)) {
+                    Card bottom = cards[len - count];
+                    if (card_color(bottom) != card_color(dest)) {
+                        moves[n++] = (Move){ from, to, count };
+                    }
+                }
+            } else if (to < FIRST_FOUNDATION) {
+                if (game->free_cells[to - FIRST_FREE_CELL].suit == SUIT_NONE) {
+                    moves[n++] = (Move){ from, to, 1 };
+                }
+            } else {
+                Card dest = game->destination_cells[to - FIRST_FOUNDATION];
+                if ((dest.suit == SUIT_NONE || dest.suit == top.suit) && top.rank == dest.rank + 1) {
+                    moves[n++] = (Move){ from, to, 1 };
+                }
+            }
+        }
+    }
+    return n;
+}
+
+static void set_foundation_rank(GameState *game, Suit suit, int rank) {
+    game->foundation_rank[suit] = rank;
+    // Spades and clubs are black, hearts and diamonds red
+    int color = (suit - 1) / 2;
+    int a = game->foundation_rank[color * 2 + 1];
+    int b = game->foundation_rank[color * 2 + 2];
+    game->color_min_rank[color] = a < b ? a : b;
+}
+
+// Rebuilds the foundation counters from destination_cells, for states that
+// were filled in by hand
+void recount_foundations(GameState *game) {
+    for (int suit = SUIT_SPADE; suit <= SUIT_DIAMOND; suit++) {
+        set_foundation_rank(game, suit, 0);
+    }
+    for (int i = 0; i < NUM_FOUNDATIONS; i++) {
+        Card top = game->destination_cells[i];
+        if (top.suit != SUIT_NONE) {
+            set_foundation_rank(game, top.suit, top.rank);
+        }
+    }
+}
+
+// Removes the top count cards of a location, bottom first. Columns above
+// the one they came from shift down to close the gap, and the space freed
+// at the end is cleared so equal positions stay byte for byte equal.
+static void take_cards(GameState *game, int location, int count, Card out[]) {
+    if (location < FIRST_FREE_CELL) {
+        Card *top = column_cards(game, location) + game->column_len[location];
+        Card *end = column_cards(game, NUM_COLUMNS);
+        memcpy(out, top - count, count);
+        memmove(top - count, top, end - top);
+        memset(end - count, 0, count);
+        game->column_len[location] -= count;
+    } else if (location < FIRST_FOUNDATION) {
+        out[0] = game->free_cells[location - FIRST_FREE_CELL];
+        game->free_cells[location - FIRST_FREE_CELL] = CARD_NONE;
+    } else {
+        Card *top = &game->destination_cells[location - FIRST_FOUNDATION];
+        out[0] = *top;
+        set_foundation_rank(game, top->suit, top->rank - 1);
+        *top = top->rank > 1 ? (Card){top->rank - 1, top->suit} : CARD_NONE;
+    }
+}
+
+// Columns above the one the cards go on shift up to make room
+static void put_cards(GameState *game, int location, int count, Card cards[]) {
+    if (location < FIRST_FREE_CELL) {
+        Card *top = column_cards(game, location) + game->column_len[location];
+        Card *end = column_cards(game, NUM_COLUMNS);
+        memmove(top + count, top, end - top);
+        memcpy(top, cards, count);
+        game->column_len[location] += count;
+    } else if (location < FIRST_FOUNDATION) {
+        game->free_cells[location - FIRST_FREE_CELL] = cards[0];
+    } else {
+        game->destination_cells[location - FIRST_FOUNDATION] = cards[0];
+        set_foundation_rank(game, cards[0].suit, cards[0].rank);
+    }
+}
+
+// The move must be legal
+void apply_move(GameState *game, Move move) {
+    Card cards[52];
+    take_cards(game, move.from, move.count, cards);
+    put_cards(game, move.to, move.count, cards);
+}
+
+// Reverts a move, which must be the last one applied
+void undo_move(GameState *game, Move move) {
+    Card cards[52];
+    take_cards(game, move.to, move.count, cards);
+    put_cards(game, move.from, move.count, cards);
+}
+
+// Whether a card can go home without ever being missed: every card of the
+// opposite colour that could still be stacked on it is already home. Aces
+// and twos are always safe, since nothing would wait on an ace to play a two.
+bool is_safe_to_foundation(GameState *game, Card card) {
+    return card.rank <= 2 || card.rank <= game->color_min_rank[!card_color(card)] + 1;
+}
+
+// Foundation a card can go on next, or -1
+static int foundation_for(GameState *game, Card card) {
+    if (game->foundation_rank[card.suit] != card.rank - 1) {
+        return -1;
+    }
+    for (int i = 0; i < NUM_FOUNDATIONS; i++) {
+        Card top = game->destination_cells[i];
+        if (card.rank == 1 ? top.suit == SUIT_NONE : top.suit == card.suit) {
+            return FIRST_FOUNDATION + i;
+        }
+    }
+    return -1;
+}
+
+// Plays safe foundation moves from the columns and free cells until none
+// are left. The moves made are written to moves, at most 52, and their
+// number returned.
+int auto_moves(GameState *game, Move moves[]) {
+    int n = 0;
+    bool moved = true;
+    while (moved) {
+        moved = false;
+        for (int from = 0; from < FIRST_FOUNDATION; from++) {
+            int len = location_len(game, from);
+            if (len == 0) {
+                continue;
+            }
+            Card card = location_card(game, from, len - 1);
+            if (!is_safe_to_foundation(game, card)) {
+                continue;
+            }
+            int to = foundation_for(game, card);
+            if (to >= 0) {
+                moves[n] = (Move){ from, to, 1 };
+                apply_move(game, moves[n++]);
+                moved = true;
+            }
+        }
+    }
+    return n;
+}
+
+void undo_auto_moves(GameState *game, Move moves[], int count) {
+    for (int i = count - 1; i >= 0; i--) {
+        undo_move(game, moves[i]);
+    }
+}
+
+bool game_won(GameState *game) {
+    return game->color_min_rank[0] == 13 && game->color_min_rank[1] == 13;
+}
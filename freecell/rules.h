@@ -0,0 +1,83 @@
+#ifndef RULES_H
+#define RULES_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// FreeCell rules, independent of any windowing or rendering code.
+
+#define NUM_COLUMNS 8
+#define NUM_FREE_CELLS 4
+#define NUM_FOUNDATIONS 4
+
+// Places a move can start or end at. Columns come first, then free cells,
+// then foundations.
+#define FIRST_COLUMN 0
+#define FIRST_FREE_CELL 8
+#define FIRST_FOUNDATION 12
+#define NUM_LOCATIONS 16
+
+// Upper bound on the moves legal_moves can return
+#define MAX_MOVES 256
+
+typedef enum { SUIT_NONE, SUIT_SPADE, SUIT_CLUB, SUIT_HEART, SUIT_DIAMOND } Suit;
+
+// One byte per card
+typedef struct {
+    uint8_t rank : 4; // 1 (ace) to 13 (king), 0 for no card
+    uint8_t suit : 4; // A Suit
+} Card;
+
+// Fits in two cache lines. Everything up to foundation_rank is the position
+// itself; the rest is derived from it.
+typedef struct {
+    // The cards of all the columns back to back, first column first, each
+    // from the bottom up. Column i holds column_len[i] cards.
+    Card cards[52];
+    uint8_t column_len[NUM_COLUMNS];
+    Card free_cells[NUM_FREE_CELLS];
+    // Only the top card of each foundation is kept
+    Card destination_cells[NUM_FOUNDATIONS];
+    // Rank on the foundation of each suit, indexed by suit, and the lower of
+    // the two for each colour. Kept up to date as cards go on and off the
+    // foundations.
+    uint8_t foundation_rank[5];
+    uint8_t color_min_rank[2];
+} GameState;
+
+_Static_assert(sizeof(Card) == 1, "cards should be one byte");
+_Static_assert(sizeof(GameState) <= 128, "game state should fit in two cache lines");
+
+// Moves the top count cards of one location onto another
+typedef struct {
+    uint8_t from;
+    uint8_t to;
+    uint8_t count;
+} Move;
+
+extern const Card CARD_NONE;
+
+int card_color(Card card);
+Card *column_cards(GameState *game, int column);
+
+void make_deck(Card deck[52]);
+void shuffle(Card deck[], int num_cards);
+void game_deal(GameState *game, Card deck[52]);
+void deal_from_number(GameState *game, uint32_t number);
+
+int location_len(GameState *game, int location);
+Card location_card(GameState *game, int location, int idx);
+
+int move_capacity(GameState *game, bool to_empty_column);
+bool can_pick_up(GameState *game, int from, int count);
+bool can_move(GameState *game, Move move);
+int legal_moves(GameState *game, Move moves[]);
+void recount_foundations(GameState *game);
+void apply_move(GameState *game, Move move);
+void undo_move(GameState *game, Move move);
+bool is_safe_to_foundation(GameState *game, Card card);
+int auto_moves(GameState *game, Move moves[]);
+void undo_auto_moves(GameState *game, Move moves[], int count);
+bool game_won(GameState *game);
+
+#endif // RULES_H
@@ -0,0 +1,22 @@
+#include "../common/atomic_file.h"
+#include "snapshot.h"
+
+// Stamps the snapshot so that snapshot_load can tell it is one of ours
+bool snapshot_save(const char *path, Snapshot *snapshot) {
+    snapshot->magic = SNAPSHOT_MAGIC;
+    snapshot->version = SNAPSHOT_VERSION;
+    snapshot->size = sizeof(Snapshot);
+    return atomic_file_write(path, snapshot, sizeof(Snapshot));
+}
+
+// Reads the snapshot if it is one this build wrote
+bool snapshot_load(const char *path, Snapshot *snapshot) {
+    Snapshot saved;
+    if (!mapped_file_read(path, &saved, sizeof(Snapshot))
+            || saved.magic != SNAPSHOT_MAGIC || saved.version != SNAPSHOT_VERSION
+            || saved.size != sizeof(Snapshot)) {
+        return false;
+    }
+    *snapshot = saved;
+    return true;
+}
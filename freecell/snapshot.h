@@ -0,0 +1,27 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "rules.h"
+
+// A game in progress, saved so that closing the game doesn't lose it. The
+// file is exactly one Snapshot, in the byte order of the machine that wrote
+// it, and one that doesn't match in magic, version or size is ignored.
+
+#define SNAPSHOT_MAGIC 0x4e534346 // "FCSN"
+#define SNAPSHOT_VERSION 1
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t size; // sizeof(Snapshot)
+    uint32_t deal; // The Microsoft deal number the game started from
+    GameState game; // Columns, free cells and foundations
+} Snapshot;
+
+bool snapshot_save(const char *path, Snapshot *snapshot);
+bool snapshot_load(const char *path, Snapshot *snapshot);
+
+#endif // SNAPSHOT_H
@@ -0,0 +1,220 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "rules.h"
+#include "solver.h"
+#include "timer.h"
+
+static void usage() {
+    printf("usage: freecell-solve [--mode dfs|best|optimal] [--max-nodes N] [--tt-mb MB]\n");
+    printf("                      [--search-mb MB] [--quiet] DEAL\n");
+    printf("       freecell-solve [options] --seed SEED\n");
+    printf("       freecell-solve [options] [--threads N] --range FIRST-LAST\n");
+    printf("DEAL is a Microsoft FreeCell deal number, SEED a shuffle by the C library's rand()\n");
+    printf("--mode optimal finds the fewest moves, but only for positions near the end of a\n");
+    printf("game or the easiest full deals: on most deals it runs out of nodes and reports\n");
+    printf("gave-up, which says nothing about whether the deal can be solved.\n");
+}
+
+// BATCH SOLVING
+// ----------------------------------------
+
+typedef struct {
+    bool done;
+    SolveStatus status;
+    int moves;
+    long nodes;
+    uint64_t us;
+    double tt_load;
+    double tt_hit_rate;
+    long tt_replacements;
+} DealResult;
+
+// Deals are handed out in order to the worker threads. Results come back in
+// any order and wait in a window of slots until every deal before them has
+// been printed. A worker that gets too far ahead of the printing waits for
+// room, so memory stays bounded however long the range.
+#define REORDER_WINDOW 1024
+
+typedef struct {
+    SolverOptions options;
+    long first, last;
+    long next_deal;  // Next deal to hand out
+    long next_print; // Next deal to print
+    DealResult results[REORDER_WINDOW];
+    pthread_mutex_t lock;
+    pthread_cond_t result_ready;
+    pthread_cond_t window_free;
+} Batch;
+
+static void *batch_worker(void *arg) {
+    Batch *batch = arg;
+    Solver *solver = solver_new();
+    pthread_mutex_lock(&batch->lock);
+    while (batch->next_deal <= batch->last) {
+        long deal = batch->next_deal++;
+        while (deal >= batch->next_print + REORDER_WINDOW) {
+            pthread_cond_wait(&batch->window_free, &batch->lock);
+        }
+        pthread_mutex_unlock(&batch->lock);
+
+        GameState game;
+        deal_from_number(&game, deal);
+        uint64_t t = get_performance_counter();
+        Solution solution = solver_solve(solver, &game, batch->options);
+        uint64_t us = (get_performance_counter() - t) * 1000000 / get_performance_frequency();
+        DealResult result = { true, solution.status, solution.num_moves, solution.nodes, us,
+                solution.tt_load, solution.tt_hit_rate, solution.tt_replacements };
+        free_solution(&solution);
+
+        pthread_mutex_lock(&batch->lock);
+        batch->results[(deal - batch->first) % REORDER_WINDOW] = result;
+        pthread_cond_signal(&batch->result_ready);
+    }
+    pthread_mutex_unlock(&batch->lock);
+    solver_free(solver);
+    return NULL;
+}
+
+// Solves every deal from first to last on num_threads threads, printing one
+// line per deal in deal order. Counts how many ended with each SolveStatus.
+static void solve_range(SolverOptions options, long first, long last, int num_threads,
+        long counts[NUM_SOLVE_STATUSES]) {
+    Batch *batch = calloc(1, sizeof(Batch));
+    batch->options = options;
+    batch->first = first;
+    batch->last = last;
+    batch->next_deal = first;
+    batch->next_print = first;
+    pthread_mutex_init(&batch->lock, NULL);
+    pthread_cond_init(&batch->result_ready, NULL);
+    pthread_cond_init(&batch->window_free, NULL);
+
+    pthread_t *threads = malloc(num_threads * sizeof(pthread_t));
+    for (int i = 0; i < num_threads; i++) {
+        pthread_create(&threads[i], NULL, batch_worker, batch);
+    }
+
+    double max_load = 0, hit_rate = 0;
+    long replacements = 0;
+    for (long deal = first; deal <= last; deal++) {
+        DealResult *slot = &batch->results[(deal - first) % REORDER_WINDOW];
+        pthread_mutex_lock(&batch->lock);
+        while (!slot->done) {
+            pthread_cond_wait(&batch->result_ready, &batch->lock);
+        }
+        DealResult result = *slot;
+        slot->done = false;
+        batch->next_print++;
+        pthread_cond_broadcast(&batch->window_free);
+        pthread_mutex_unlock(&batch->lock);
+
+        printf("%ld %s moves=%d nodes=%ld us=%lu\n", deal, solve_status_name(result.status),
+                result.moves, result.nodes, (unsigned long)result.us);
+        counts[result.status]++;
+        max_load = result.tt_load > max_load ? result.tt_load : max_load;
+        hit_rate += result.tt_hit_rate;
+        replacements += result.tt_replacements;
+    }
+    fprintf(stderr, "transposition table: peak load %.3f, mean hit rate %.3f, %ld replacements\n",
+            max_load, hit_rate / (last - first + 1), replacements);
+
+    for (int i = 0; i < num_threads; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+    pthread_mutex_destroy(&batch->lock);
+    pthread_cond_destroy(&batch->result_ready);
+    pthread_cond_destroy(&batch->window_free);
+    free(batch);
+}
+
+// MAIN
+// ----------------------------------------
+
+int main(int argc, char **argv) {
+    SolverOptions options = { SEARCH_BEST_FIRST, 10000000, DEFAULT_TT_MB };
+    bool quiet = false;
+    long deal = -1;
+    long seed = -1;
+    long first = -1, last = -1;
+    int num_threads = 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--mode") == 0 && i + 1 < argc) {
+            if (!parse_search_mode(argv[++i], &options.mode)) {
+                usage();
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--max-nodes") == 0 && i + 1 < argc) {
+            options.max_nodes = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--tt-mb") == 0 && i + 1 < argc) {
+            options.tt_mb = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--search-mb") == 0 && i + 1 < argc) {
+            options.search_mb = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--quiet") == 0) {
+            quiet = true;
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--range") == 0 && i + 1 < argc) {
+            if (sscanf(argv[++i], "%ld-%ld", &first, &last) != 2 || first < 0 || last < first) {
+                usage();
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            num_threads = atoi(argv[++i]);
+        } else if (argv[i][0] != '-') {
+            deal = atol(argv[i]);
+        } else {
+            usage();
+            return 1;
+        }
+    }
+    if ((deal >= 0) + (seed >= 0) + (first >= 0) != 1 || num_threads < 1) {
+        usage();
+        return 1;
+    }
+
+    if (first >= 0) {
+        uint64_t t = get_performance_counter();
+        long counts[NUM_SOLVE_STATUSES] = {0};
+        solve_range(options, first, last, num_threads, counts);
+        float seconds = (get_performance_counter() - t) / (float)get_performance_frequency();
+        fprintf(stderr, "%ld deals, %ld solved, %ld unsolvable, %ld gave up, %ld out of memory, "
+                "in %.1f s on %d threads\n", last - first + 1, counts[SOLVE_SOLVED],
+                counts[SOLVE_UNSOLVABLE], counts[SOLVE_GAVE_UP], counts[SOLVE_OUT_OF_MEMORY],
+                seconds, num_threads);
+        return counts[SOLVE_SOLVED] == last - first + 1 ? 0 : 2;
+    }
+
+    GameState game;
+    if (deal >= 0) {
+        deal_from_number(&game, deal);
+    } else {
+        srand(seed);
+        Card deck[52];
+        make_deck(deck);
+        shuffle(deck, 52);
+        game_deal(&game, deck);
+    }
+
+    uint64_t t = get_performance_counter();
+    Solution solution = solve(&game, options);
+    uint64_t us = (get_performance_counter() - t) * 1000000 / get_performance_frequency();
+
+    printf("%s moves=%d nodes=%ld us=%lu peak_kb=%zu tt_load=%.3f tt_hit=%.3f tt_replaced=%ld\n",
+            solve_status_name(solution.status), solution.num_moves, solution.nodes,
+            (unsigned long)us, solution.peak_memory / 1024,
+            solution.tt_load, solution.tt_hit_rate, solution.tt_replacements);
+    if (!quiet && solution.status == SOLVE_SOLVED) {
+        for (int i = 0; i < solution.num_moves; i++) {
+            char name[16];
+            format_move(solution.moves[i], name);
+            printf("%s%c", name, i % 16 == 15 || i == solution.num_moves - 1 ? '\n' : ' ');
+        }
+    }
+    free_solution(&solution);
+    return solution.status == SOLVE_SOLVED ? 0 : 2;
+}
@@ -0,0 +1,748 @@
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "solver.h"
+
+// TRANSPOSITION TABLE
+// ----------------------------------------
+
+// Fixed-size map from position hash to the fewest moves the position has
+// been reached in. Positions that don't fit are forgotten, and may be
+// searched again. Each entry packs 40 bits of the hash to check against, the
+// generation of the search that stored it and the move count into 8 bytes.
+// Entries from an earlier generation count as empty, so the table needn't
+// be cleared between solves.
+typedef uint64_t TableEntry;
+
+#define ENTRY_CHECK(entry) ((entry) >> 24)
+#define ENTRY_GENERATION(entry) (((entry) >> 16) & 0xff)
+#define ENTRY_MOVES(entry) ((entry) & 0xffff)
+
+// Entries are grouped in buckets of four. The first three keep the
+// positions reached in the fewest moves, whose subtrees are the largest; the
+// last takes whatever was pushed out or didn't make it into the others.
+#define BUCKET_SIZE 4
+#define BUCKET_PREFERRED 3
+
+typedef struct {
+    TableEntry *entries;
+    size_t num_buckets; // Always a power of two
+    uint64_t generation;
+    long count; // Entries of this generation
+    long probes;
+    long hits;
+    long replacements;
+} TranspositionTable;
+
+static void table_init(TranspositionTable *table, int mb) {
+    size_t buckets = (size_t)mb * 1024 * 1024 / (BUCKET_SIZE * sizeof(TableEntry));
+    table->num_buckets = 1;
+    while (table->num_buckets * 2 <= buckets) {
+        table->num_buckets *= 2;
+    }
+    table->entries = calloc(table->num_buckets * BUCKET_SIZE, sizeof(TableEntry));
+    table->generation = 1;
+}
+
+static void table_free(TranspositionTable *table) {
+    free(table->entries);
+    table->entries = NULL;
+}
+
+static size_t table_bytes(TranspositionTable *table) {
+    return table->num_buckets * BUCKET_SIZE * sizeof(TableEntry);
+}
+
+// Starts a new generation, which empties the table. Only when the generation
+// counter wraps do the entries actually need clearing.
+static void table_next_generation(TranspositionTable *table) {
+    table->generation++;
+    if (table->generation > 0xff) {
+        memset(table->entries, 0, table_bytes(table));
+        table->generation = 1;
+    }
+    table->count = 0;
+    table->probes = 0;
+    table->hits = 0;
+    table->replacements = 0;
+}
+
+// Records that a position was reached in the given number of moves. Returns
+// false if it had already been reached in as few.
+static bool table_insert(TranspositionTable *table, uint64_t key, uint32_t moves) {
+    TableEntry *bucket = &table->entries[(key & (table->num_buckets - 1)) * BUCKET_SIZE];
+    uint64_t check = key >> 24;
+    TableEntry entry = check << 24 | table->generation << 16 | (moves > 0xffff ? 0xffff : moves);
+    table->probes++;
+
+    int empty = -1;
+    for (int i = 0; i < BUCKET_SIZE; i++) {
+        if (ENTRY_GENERATION(bucket[i]) != table->generation) {
+            if (empty < 0) empty = i;
+        } else if (ENTRY_CHECK(bucket[i]) == check) {
+            table->hits++;
+            if (moves < ENTRY_MOVES(bucket[i])) {
+                bucket[i] = entry;
+                return true;
+            }
+            return false;
+        }
+    }
+    if (empty >= 0) {
+        bucket[empty] = entry;
+        table->count++;
+        return true;
+    }
+
+    // The bucket is full. A position reached in fewer moves than the worst
+    // preferred entry takes its place, and that entry moves down to the
+    // last slot instead.
+    int worst = 0;
+    for (int i = 1; i < BUCKET_PREFERRED; i++) {
+        if (ENTRY_MOVES(bucket[i]) > ENTRY_MOVES(bucket[worst])) worst = i;
+    }
+    if (ENTRY_MOVES(entry) < ENTRY_MOVES(bucket[worst])) {
+        TableEntry displaced = bucket[worst];
+        bucket[worst] = entry;
+        entry = displaced;
+    }
+    bucket[BUCKET_SIZE - 1] = entry;
+    table->replacements++;
+    return true;
+}
+
+// POSITIONS
+// ----------------------------------------
+
+static uint64_t hash_byte(uint64_t h, uint8_t byte) {
+    h ^= byte;
+    return h * 1099511628211ULL;
+}
+
+static uint8_t card_byte(Card card) {
+    return card.suit == SUIT_NONE ? 0 : card.rank * 4 + card.suit - 1;
+}
+
+// Hash of the position with the order of columns, free cells and
+// foundations factored out, since none of them change what can be played.
+// Columns are taken in order of their bottom card, free cells sorted, and
+// foundations read by suit.
+uint64_t canonical_hash(GameState *game) {
+    Card *columns[NUM_COLUMNS];
+    int lens[NUM_COLUMNS];
+    uint8_t bottoms[NUM_COLUMNS];
+    Card *pile = game->cards;
+    for (int i = 0; i < NUM_COLUMNS; i++) {
+        int len = game->column_len[i];
+        uint8_t bottom = len > 0 ? card_byte(pile[0]) : 0;
+        int j = i;
+        while (j > 0 && bottoms[j - 1] > bottom) {
+            columns[j] = columns[j - 1];
+            lens[j] = lens[j - 1];
+            bottoms[j] = bottoms[j - 1];
+            j--;
+        }
+        columns[j] = pile;
+        lens[j] = len;
+        bottoms[j] = bottom;
+        pile += len;
+    }
+
+    uint8_t free_cells[NUM_FREE_CELLS];
+    for (int i = 0; i < NUM_FREE_CELLS; i++) {
+        uint8_t card = card_byte(game->free_cells[i]);
+        int j = i;
+        while (j > 0 && free_cells[j - 1] > card) {
+            free_cells[j] = free_cells[j - 1];
+            j--;
+        }
+        free_cells[j] = card;
+    }
+
+    uint64_t h = 14695981039346656037ULL;
+    for (int i = 0; i < NUM_COLUMNS; i++) {
+        for (int j = 0; j < lens[i]; j++) {
+            h = hash_byte(h, card_byte(columns[i][j]));
+        }
+        h = hash_byte(h, 0);
+    }
+    for (int i = 0; i < NUM_FREE_CELLS; i++) {
+        h = hash_byte(h, free_cells[i]);
+    }
+    for (int suit = 1; suit <= 4; suit++) {
+        h = hash_byte(h, game->foundation_rank[suit]);
+    }
+    return h;
+}
+
+// Higher scores are tried first
+static int score_move(GameState *game, Move move) {
+    if (move.to >= FIRST_FOUNDATION) {
+        return 4;
+    }
+    if (move.to >= FIRST_FREE_CELL) {
+        return 0;
+    }
+    if (location_len(game, move.to) == 0) {
+        return 1;
+    }
+    // Emptying a column or a free cell frees up room for later supermoves
+    return location_len(game, move.from) == move.count ? 3 : 2;
+}
+
+// Legal moves without the ones that can't lead anywhere new: free cell to
+// free cell, a whole column into an empty one, and all but the first of
+// several interchangeable empty free cells or columns. Best moves first.
+static int solver_moves(GameState *game, Move moves[]) {
+    Move all[MAX_MOVES];
+    int total = legal_moves(game, all);
+
+    int first_free_cell = -1;
+    for (int i = 0; i < NUM_FREE_CELLS && first_free_cell < 0; i++) {
+        if (game->free_cells[i].suit == SUIT_NONE) first_free_cell = FIRST_FREE_CELL + i;
+    }
+    int first_empty_column = -1;
+    for (int i = 0; i < NUM_COLUMNS && first_empty_column < 0; i++) {
+        if (game->column_len[i] == 0) first_empty_column = FIRST_COLUMN + i;
+    }
+
+    int n = 0;
+    int scores[MAX_MOVES];
+    for (int i = 0; i < total; i++) {
+        Move move = all[i];
+        bool from_free_cell = move.from >= FIRST_FREE_CELL;
+        if (move.to >= FIRST_FREE_CELL && move.to < FIRST_FOUNDATION) {
+            if (from_free_cell || move.to != first_free_cell) continue;
+        }
+        if (move.to < FIRST_FREE_CELL && location_len(game, move.to) == 0) {
+            if (move.to != first_empty_column) continue;
+            if (!from_free_cell && location_len(game, move.from) == move.count) continue;
+        }
+
+        // Insertion sort by score, keeping generation order among equals
+        int score = score_move(game, move);
+        int j = n++;
+        while (j > 0 && scores[j - 1] < score) {
+            moves[j] = moves[j - 1];
+            scores[j] = scores[j - 1];
+            j--;
+        }
+        moves[j] = move;
+        scores[j] = score;
+    }
+    return n;
+}
+
+// HEURISTICS
+// ----------------------------------------
+
+// A lower bound on the moves left. Every card not home needs a move to a
+// foundation. On top of that, a card above a lower card of its own suit in
+// the same column needs a move out of the column that isn't to a
+// foundation, since neither card can go home first. Cards only leave a
+// column together if they are in sequence there, so the column needs at
+// least one such move for each run in it that holds one of those cards.
+// The bound drops by at most one per move, so A* never has to reopen a
+// position.
+static int admissible_heuristic(GameState *game) {
+    uint8_t *ranks = game->foundation_rank;
+    int h = 52;
+    for (int suit = 1; suit <= 4; suit++) {
+        h -= ranks[suit];
+    }
+    Card *pile = game->cards;
+    for (int i = 0; i < NUM_COLUMNS; i++) {
+        // Lowest rank seen so far of each suit, going up the column
+        int lowest[5] = { 14, 14, 14, 14, 14 };
+        bool run_counted = false;
+        int len = game->column_len[i];
+        for (int j = 0; j < len; j++) {
+            if (j > 0 && (pile[j].rank != pile[j - 1].rank - 1
+                    || card_color(pile[j]) == card_color(pile[j - 1]))) {
+                run_counted = false;
+            }
+            if (pile[j].rank > lowest[pile[j].suit]) {
+                if (!run_counted) {
+                    h++;
+                    run_counted = true;
+                }
+            } else {
+                lowest[pile[j].suit] = pile[j].rank;
+            }
+        }
+        pile += len;
+    }
+    return h;
+}
+
+// Not a bound, just an estimate of how far a position is from being won:
+// foundation progress, how deep the next card each foundation needs is
+// buried, and how many free cells are taken.
+static int greedy_heuristic(GameState *game) {
+    uint8_t *ranks = game->foundation_rank;
+    int h = 0;
+    for (int suit = 1; suit <= 4; suit++) {
+        h += 4 * (13 - ranks[suit]);
+    }
+    Card *pile = game->cards;
+    for (int i = 0; i < NUM_COLUMNS; i++) {
+        int len = game->column_len[i];
+        for (int j = 0; j < len; j++) {
+            if (pile[j].rank == ranks[pile[j].suit] + 1) {
+                h += len - 1 - j;
+            }
+        }
+        pile += len;
+    }
+    for (int i = 0; i < NUM_FREE_CELLS; i++) {
+        h += 2 * (game->free_cells[i].suit != SUIT_NONE);
+    }
+    return h;
+}
+
+// SEARCH STATE
+// ----------------------------------------
+
+// Out of nodes, or asked to stop. The cancel flag is only looked at every
+// 1024 nodes.
+static bool should_give_up(SolverOptions *options, long nodes) {
+    if (options->max_nodes > 0 && nodes >= options->max_nodes) {
+        return true;
+    }
+    return options->cancel && nodes % 1024 == 0 && atomic_load(options->cancel);
+}
+
+typedef struct {
+    Move moves[MAX_MOVES];
+    int num_moves;
+    int next; // Index of the next move to try; the one before it is applied
+    // Safe foundation moves played after the applied move
+    Move auto_moves[52];
+    int num_auto;
+} SearchFrame;
+
+// Positions are stored without the foundation counters, which are rebuilt
+// when a node is expanded
+#define PACKED_SIZE offsetof(GameState, foundation_rank)
+
+typedef struct {
+    uint8_t bytes[PACKED_SIZE];
+    Move move;      // Move that led here from the parent, before safe moves
+    int32_t parent; // Index of the parent node, -1 for the start
+    uint16_t moves; // Moves from the start, safe moves included
+} SearchNode;
+
+// Binary min-heap of node indices ordered by (priority, then fewer
+// estimated moves left)
+typedef struct {
+    int32_t node;
+    int32_t priority;
+    int32_t estimate;
+} HeapEntry;
+
+typedef struct {
+    HeapEntry *entries;
+    int count;
+    int capacity;
+} Heap;
+
+// Search memory, reused from one solve to the next
+struct Solver {
+    TranspositionTable table;
+    int tt_mb; // Size the table was made for
+    size_t search_budget; // Bytes the arrays below may take, for this solve
+    SearchFrame *stack; // Depth-first
+    int stack_capacity;
+    SearchNode *nodes; // Best-first
+    int node_capacity;
+    Heap open;
+};
+
+static size_t search_bytes(Solver *solver) {
+    return solver->stack_capacity * sizeof(SearchFrame)
+        + solver->node_capacity * sizeof(SearchNode)
+        + solver->open.capacity * sizeof(HeapEntry);
+}
+
+static size_t solver_memory(Solver *solver) {
+    return table_bytes(&solver->table) + search_bytes(solver);
+}
+
+// Doubles one of the search's arrays, or returns NULL and leaves it as it
+// was if that would take the search past its budget
+static void *search_grow(Solver *solver, void *array, int *capacity, size_t size) {
+    int grown = *capacity ? *capacity * 2 : 1024;
+    if (search_bytes(solver) + (grown - *capacity) * size > solver->search_budget) {
+        return NULL;
+    }
+    array = realloc(array, grown * size);
+    if (array) {
+        *capacity = grown;
+    }
+    return array;
+}
+
+// DEPTH-FIRST SEARCH
+// ----------------------------------------
+
+// Depth-first search over supermoves, never revisiting a position. Safe
+// foundation moves are played straight after each move rather than searched.
+static Solution solve_dfs(Solver *solver, GameState *start, SolverOptions options) {
+    Solution solution = { SOLVE_UNSOLVABLE, NULL, 0, 0, 0 };
+    GameState game = *start;
+    Move start_auto[52];
+    int num_start_auto = auto_moves(&game, start_auto);
+
+    TranspositionTable *table = &solver->table;
+    table_insert(table, canonical_hash(&game), 0);
+
+    SearchFrame *stack = solver->stack;
+    int depth = 0;
+    stack[0].num_moves = solver_moves(&game, stack[0].moves);
+    stack[0].next = 0;
+    solution.nodes = 1;
+
+    while (depth >= 0) {
+        if (game_won(&game)) {
+            solution.status = SOLVE_SOLVED;
+            break;
+        }
+        if (should_give_up(&options, solution.nodes)) {
+            solution.status = SOLVE_GAVE_UP;
+            break;
+        }
+
+        SearchFrame *frame = &stack[depth];
+        if (frame->next > 0) {
+            undo_auto_moves(&game, frame->auto_moves, frame->num_auto);
+            undo_move(&game, frame->moves[frame->next - 1]);
+        }
+        if (frame->next == frame->num_moves) {
+            // Out of moves here, go back up
+            depth--;
+            continue;
+        }
+        Move move = frame->moves[frame->next++];
+        apply_move(&game, move);
+        frame->num_auto = auto_moves(&game, frame->auto_moves);
+        if (!table_insert(table, canonical_hash(&game), 0)) {
+            continue;
+        }
+
+        if (depth + 1 == solver->stack_capacity) {
+            SearchFrame *grown = search_grow(solver, stack, &solver->stack_capacity,
+                    sizeof(SearchFrame));
+            if (!grown) {
+                solution.status = SOLVE_OUT_OF_MEMORY;
+                break;
+            }
+            stack = solver->stack = grown;
+        }
+        depth++;
+        stack[depth].num_moves = solver_moves(&game, stack[depth].moves);
+        stack[depth].next = 0;
+        solution.nodes++;
+
+        size_t memory = solver_memory(solver);
+        if (memory > solution.peak_memory) {
+            solution.peak_memory = memory;
+        }
+    }
+
+    if (solution.status == SOLVE_SOLVED) {
+        // The path is the last move applied at each level above the winning
+        // one, each followed by the safe moves it led to
+        int total = num_start_auto;
+        for (int i = 0; i < depth; i++) {
+            total += 1 + stack[i].num_auto;
+        }
+        solution.moves = malloc((total > 0 ? total : 1) * sizeof(Move));
+        memcpy(solution.moves, start_auto, num_start_auto * sizeof(Move));
+        solution.num_moves = num_start_auto;
+        for (int i = 0; i < depth; i++) {
+            solution.moves[solution.num_moves++] = stack[i].moves[stack[i].next - 1];
+            memcpy(&solution.moves[solution.num_moves], stack[i].auto_moves, stack[i].num_auto * sizeof(Move));
+            solution.num_moves += stack[i].num_auto;
+        }
+    }
+    return solution;
+}
+
+// BEST-FIRST SEARCH
+// ----------------------------------------
+
+static void pack_state(GameState *game, uint8_t bytes[PACKED_SIZE]) {
+    memcpy(bytes, game, PACKED_SIZE);
+}
+
+static void unpack_state(uint8_t bytes[PACKED_SIZE], GameState *game) {
+    memcpy(game, bytes, PACKED_SIZE);
+    recount_foundations(game);
+}
+
+static bool heap_less(HeapEntry a, HeapEntry b) {
+    return a.priority < b.priority || (a.priority == b.priority && a.estimate < b.estimate);
+}
+
+// The heap must have room for the entry, see search_grow
+static void heap_push(Heap *heap, HeapEntry entry) {
+    int i = heap->count++;
+    while (i > 0 && heap_less(entry, heap->entries[(i - 1) / 2])) {
+        heap->entries[i] = heap->entries[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    heap->entries[i] = entry;
+}
+
+static HeapEntry heap_pop(Heap *heap) {
+    HeapEntry top = heap->entries[0];
+    HeapEntry last = heap->entries[--heap->count];
+    int i = 0;
+    for (;;) {
+        int child = i * 2 + 1;
+        if (child >= heap->count) break;
+        if (child + 1 < heap->count && heap_less(heap->entries[child + 1], heap->entries[child])) {
+            child++;
+        }
+        if (!heap_less(heap->entries[child], last)) break;
+        heap->entries[i] = heap->entries[child];
+        i = child;
+    }
+    heap->entries[i] = last;
+    return top;
+}
+
+// Expands the most promising position first. When optimal, promise is moves
+// so far plus the admissible bound (A*), so the first solution found is as
+// short as possible. Otherwise it is the greedy estimate alone. Safe
+// foundation moves are played straight after each move, as in solve_dfs.
+static Solution solve_best_first(Solver *solver, GameState *start, SolverOptions options, bool optimal) {
+    Solution solution = { SOLVE_UNSOLVABLE, NULL, 0, 0, 0 };
+
+    TranspositionTable *table = &solver->table;
+    Heap *open = &solver->open;
+    open->count = 0;
+    SearchNode *nodes = solver->nodes;
+    int num_nodes = 0;
+
+    GameState game = *start;
+    Move safe[52];
+    int num_safe = auto_moves(&game, safe);
+    pack_state(&game, nodes[0].bytes);
+    nodes[0].parent = -1;
+    nodes[0].moves = num_safe;
+    num_nodes = 1;
+    table_insert(table, canonical_hash(&game), 0);
+    if (open->capacity == 0) {
+        open->entries = search_grow(solver, open->entries, &open->capacity, sizeof(HeapEntry));
+        if (!open->entries) {
+            solution.status = SOLVE_OUT_OF_MEMORY;
+            return solution;
+        }
+    }
+    heap_push(open, (HeapEntry){ 0, 0, 0 });
+
+    int goal = -1;
+    while (open->count > 0 && solution.status != SOLVE_OUT_OF_MEMORY) {
+        if (should_give_up(&options, solution.nodes)) {
+            solution.status = SOLVE_GAVE_UP;
+            break;
+        }
+        HeapEntry entry = heap_pop(open);
+        SearchNode *node = &nodes[entry.node];
+        unpack_state(node->bytes, &game);
+        if (game_won(&game)) {
+            goal = entry.node;
+            solution.status = SOLVE_SOLVED;
+            break;
+        }
+        solution.nodes++;
+
+        Move moves[MAX_MOVES];
+        int num_moves = solver_moves(&game, moves);
+        int parent_moves = node->moves;
+        for (int i = 0; i < num_moves; i++) {
+            apply_move(&game, moves[i]);
+            num_safe = auto_moves(&game, safe);
+            int child_moves = parent_moves + 1 + num_safe;
+            bool room = true;
+            if (num_nodes == solver->node_capacity) {
+                SearchNode *grown = search_grow(solver, nodes, &solver->node_capacity,
+                        sizeof(SearchNode));
+                room = grown != NULL;
+                nodes = solver->nodes = grown ? grown : nodes;
+            }
+            if (room && open->count == open->capacity) {
+                HeapEntry *grown = search_grow(solver, open->entries, &open->capacity,
+                        sizeof(HeapEntry));
+                room = grown != NULL;
+                open->entries = grown ? grown : open->entries;
+            }
+            if (!room) {
+                // Out of budget: stop with this position as it was
+                undo_auto_moves(&game, safe, num_safe);
+                undo_move(&game, moves[i]);
+                solution.status = SOLVE_OUT_OF_MEMORY;
+                break;
+            }
+            if (table_insert(table, canonical_hash(&game), child_moves)) {
+                SearchNode *child = &nodes[num_nodes];
+                pack_state(&game, child->bytes);
+                child->move = moves[i];
+                child->parent = entry.node;
+                child->moves = child_moves;
+
+                HeapEntry child_entry = { num_nodes, 0, 0 };
+                if (optimal) {
+                    child_entry.estimate = admissible_heuristic(&game);
+                    child_entry.priority = child->moves + child_entry.estimate;
+                } else {
+                    child_entry.priority = greedy_heuristic(&game);
+                    child_entry.estimate = child->moves;
+                }
+                heap_push(open, child_entry);
+                num_nodes++;
+            }
+            undo_auto_moves(&game, safe, num_safe);
+            undo_move(&game, moves[i]);
+        }
+
+        size_t memory = solver_memory(solver);
+        if (memory > solution.peak_memory) {
+            solution.peak_memory = memory;
+        }
+    }
+
+    if (goal >= 0) {
+        // Nodes only keep the move that was chosen, so replay the path from
+        // the start to fill in the safe moves after each one
+        int depth = 0;
+        for (int i = goal; nodes[i].parent >= 0; i = nodes[i].parent) {
+            depth++;
+        }
+        Move *path = malloc((depth > 0 ? depth : 1) * sizeof(Move));
+        for (int i = goal, j = depth; nodes[i].parent >= 0; i = nodes[i].parent) {
+            path[--j] = nodes[i].move;
+        }
+
+        solution.moves = malloc((nodes[goal].moves > 0 ? nodes[goal].moves : 1) * sizeof(Move));
+        game = *start;
+        solution.num_moves = auto_moves(&game, solution.moves);
+        for (int i = 0; i < depth; i++) {
+            apply_move(&game, path[i]);
+            solution.moves[solution.num_moves++] = path[i];
+            solution.num_moves += auto_moves(&game, &solution.moves[solution.num_moves]);
+        }
+        free(path);
+    }
+    return solution;
+}
+
+// SOLVER
+// ----------------------------------------
+
+Solver *solver_new() {
+    Solver *solver = calloc(1, sizeof(Solver));
+    solver->stack_capacity = 256;
+    solver->stack = malloc(solver->stack_capacity * sizeof(SearchFrame));
+    solver->node_capacity = 1 << 16;
+    solver->nodes = malloc(solver->node_capacity * sizeof(SearchNode));
+    return solver;
+}
+
+void solver_free(Solver *solver) {
+    table_free(&solver->table);
+    free(solver->stack);
+    free(solver->nodes);
+    free(solver->open.entries);
+    free(solver);
+}
+
+// Solves with the solver's memory, which is kept for the next call
+Solution solver_solve(Solver *solver, GameState *game, SolverOptions options) {
+    int mb = options.tt_mb > 0 ? options.tt_mb : DEFAULT_TT_MB;
+    TranspositionTable *table = &solver->table;
+    if (table->entries && mb != solver->tt_mb) {
+        table_free(table);
+    }
+    if (!table->entries) {
+        table_init(table, mb);
+        solver->tt_mb = mb;
+    }
+
+    int search_mb = options.search_mb > 0 ? options.search_mb : DEFAULT_SEARCH_MB;
+    solver->search_budget = (size_t)search_mb * 1024 * 1024;
+
+    Solution solution = { SOLVE_UNSOLVABLE, NULL, 0, 0, 0 };
+    switch (options.mode) {
+        case SEARCH_DFS:
+            solution = solve_dfs(solver, game, options);
+            break;
+        case SEARCH_BEST_FIRST:
+            solution = solve_best_first(solver, game, options, false);
+            break;
+        case SEARCH_OPTIMAL:
+            solution = solve_best_first(solver, game, options, true);
+            break;
+    }
+    solution.tt_load = table->count / (double)(table->num_buckets * BUCKET_SIZE);
+    solution.tt_hit_rate = table->probes ? table->hits / (double)table->probes : 0;
+    solution.tt_replacements = table->replacements;
+    table_next_generation(table);
+    return solution;
+}
+
+Solution solve(GameState *game, SolverOptions options) {
+    Solver *solver = solver_new();
+    Solution solution = solver_solve(solver, game, options);
+    solver_free(solver);
+    return solution;
+}
+
+void free_solution(Solution *solution) {
+    free(solution->moves);
+    solution->moves = NULL;
+    solution->num_moves = 0;
+}
+
+bool parse_search_mode(const char *name, SearchMode *mode) {
+    if (strcmp(name, "dfs") == 0) {
+        *mode = SEARCH_DFS;
+    } else if (strcmp(name, "best") == 0) {
+        *mode = SEARCH_BEST_FIRST;
+    } else if (strcmp(name, "optimal") == 0) {
+        *mode = SEARCH_OPTIMAL;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char *solve_status_name(SolveStatus status) {
+    switch (status) {
+        case SOLVE_SOLVED: return "solved";
+        case SOLVE_UNSOLVABLE: return "unsolvable";
+        case SOLVE_GAVE_UP: return "gave-up";
+        case SOLVE_OUT_OF_MEMORY: return "out-of-memory";
+        case NUM_SOLVE_STATUSES: break;
+    }
+    return "unknown";
+}
+
+// Standard notation: columns 1-8, free cells a-d, foundations h. Runs of
+// more than one card get their length appended.
+static char location_name(int location) {
+    if (location < FIRST_FREE_CELL) return '1' + location;
+    if (location < FIRST_FOUNDATION) return 'a' + location - FIRST_FREE_CELL;
+    return 'h';
+}
+
+void format_move(Move move, char out[16]) {
+    if (move.count > 1) {
+        snprintf(out, 16, "%c%cx%d", location_name(move.from), location_name(move.to), move.count);
+    } else {
+        snprintf(out, 16, "%c%c", location_name(move.from), location_name(move.to));
+    }
+}
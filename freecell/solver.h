@@ -0,0 +1,64 @@
+#ifndef SOLVER_H
+#define SOLVER_H
+
+#include "rules.h"
+
+#include <stdatomic.h>
+#include <stddef.h>
+
+typedef enum {
+    SOLVE_SOLVED,
+    SOLVE_UNSOLVABLE,
+    SOLVE_GAVE_UP,       // Out of nodes, or cancelled
+    SOLVE_OUT_OF_MEMORY, // The search needed more than its memory budget
+    NUM_SOLVE_STATUSES,
+} SolveStatus;
+
+typedef enum {
+    SEARCH_DFS,        // Depth-first, first solution found
+    SEARCH_BEST_FIRST, // Greedy best-first, first solution found, usually short
+    SEARCH_OPTIMAL,    // A* with an admissible heuristic, fewest moves
+} SearchMode;
+
+#define DEFAULT_TT_MB 16
+#define DEFAULT_SEARCH_MB 256
+
+typedef struct {
+    SearchMode mode;
+    long max_nodes; // Give up after expanding this many positions, 0 for no limit
+    int tt_mb;      // Transposition table size in megabytes, 0 for DEFAULT_TT_MB
+    atomic_int *cancel; // Give up as soon as this is set, if not NULL
+    // Most the search's own arrays may grow to in megabytes, on top of the
+    // transposition table, 0 for DEFAULT_SEARCH_MB
+    int search_mb;
+} SolverOptions;
+
+typedef struct {
+    SolveStatus status;
+    Move *moves; // Owned by the solution, see free_solution
+    int num_moves;
+    long nodes;         // Positions expanded
+    size_t peak_memory; // Most bytes held by the search at once
+    // Transposition table use: the fraction of entries filled, the fraction
+    // of lookups that found the position, and entries pushed out
+    double tt_load;
+    double tt_hit_rate;
+    long tt_replacements;
+} Solution;
+
+// Memory for searching, which can be kept to solve one deal after another
+// without allocating again. One per thread.
+typedef struct Solver Solver;
+
+Solver *solver_new();
+void solver_free(Solver *solver);
+Solution solver_solve(Solver *solver, GameState *game, SolverOptions options);
+Solution solve(GameState *game, SolverOptions options);
+uint64_t canonical_hash(GameState *game);
+void free_solution(Solution *solution);
+
+const char *solve_status_name(SolveStatus status);
+bool parse_search_mode(const char *name, SearchMode *mode);
+void format_move(Move move, char out[16]);
+
+#endif // SOLVER_H
@@ -0,0 +1,257 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common/fuzz_driver.h"
+#include "replay.h"
+#include "rules.h"
+#include "solver.h"
+#include "table.h"
+
+/*
+ * Plays random legal moves through both copies of Spider's rules, the
+ * game's on Pile and the solver's on Position, and checks after every move
+ * that the table still makes sense and that the two agree. The driver that
+ * deals, shrinks and reports is shared with freecell-fuzz, in common/.
+ */
+
+/* Set once from --suits, before any thread starts */
+static int num_suits = 4;
+
+typedef struct {
+    Position pos;
+    Pile piles[NUM_PILES];
+    Pile deal_piles[NUM_DEALS];
+    Pile goal_piles[NUM_COMPLETE];
+    int num_deal_piles;
+    int num_completed;
+    /* How many of each card the deal had, which a move can't change */
+    int counts[52];
+} Game;
+
+static void count_pile(Pile *pile, int counts[52])
+{
+    for (int i = 0; i < pile->num_cards; i++) {
+        counts[pile->cards[i].suit * 13 + pile->cards[i].rank]++;
+    }
+}
+
+static void count_cards(Game *game, int counts[52])
+{
+    memset(counts, 0, 52 * sizeof(int));
+    for (int i = 0; i < NUM_PILES; i++) {
+        count_pile(&game->piles[i], counts);
+    }
+    for (int i = 0; i < game->num_deal_piles; i++) {
+        count_pile(&game->deal_piles[i], counts);
+    }
+    for (int i = 0; i < game->num_completed; i++) {
+        count_pile(&game->goal_piles[i], counts);
+    }
+}
+
+static void start_game(void *state, uint32_t seed)
+{
+    Game *game = state;
+    memset(game, 0, sizeof(*game));
+    deal_position(&game->pos, seed, num_suits);
+    set_table(&game->pos, game->piles, game->deal_piles);
+    game->num_deal_piles = NUM_DEALS;
+    count_cards(game, game->counts);
+}
+
+/*
+ * Whether the game's checks allow the move exactly when the solver's do.
+ */
+static const char *check_rules(Game *game, Move move)
+{
+    bool legal = is_legal_move(&game->pos, move);
+    bool allowed;
+    if (move.from == DEAL_MOVE) {
+        bool any_empty = false;
+        for (int i = 0; i < NUM_PILES; i++) {
+            any_empty |= game->piles[i].num_cards == 0;
+        }
+        allowed = game->num_deal_piles > 0 && !any_empty;
+        return allowed == legal ? NULL : "dealing allowed differently";
+    }
+    Pile *src = &game->piles[move.from];
+    allowed = move.from != move.to && move.count >= 1 && move.count <= src->num_cards
+        && can_pick_up(src, src->num_cards - move.count);
+    if (allowed) {
+        /* What the player would be holding, of which only the bottom card counts */
+        Pile holding;
+        holding.cards[0] = src->cards[src->num_cards - move.count];
+        holding.num_cards = move.count;
+        allowed = can_place(&holding, &game->piles[move.to]);
+    }
+    return allowed == legal ? NULL : "move allowed differently";
+}
+
+static const char *check_pile(Pile *pile)
+{
+    if (pile->num_cards < 0 || pile->num_cards > DECK_SIZE) {
+        return "pile size out of bounds";
+    }
+    for (int i = 1; i < pile->num_cards; i++) {
+        if (pile->cards[i].orientation == FACEDOWN && pile->cards[i - 1].orientation == FACEUP) {
+            return "face-down card above a face-up one";
+        }
+    }
+    if (pile->num_cards > 0 && pile->cards[pile->num_cards - 1].orientation == FACEDOWN) {
+        return "top card face down";
+    }
+    return NULL;
+}
+
+/*
+ * Everything that should hold between moves, or what doesn't.
+ */
+static const char *check_game(Game *game)
+{
+    if (game->num_deal_piles < 0 || game->num_deal_piles > NUM_DEALS
+            || game->num_completed < 0 || game->num_completed > NUM_COMPLETE) {
+        return "deal or goal piles out of bounds";
+    }
+    for (int i = 0; i < NUM_PILES; i++) {
+        const char *error = check_pile(&game->piles[i]);
+        if (error) {
+            return error;
+        }
+    }
+    for (int i = 0; i < game->num_deal_piles; i++) {
+        if (game->deal_piles[i].num_cards != NUM_PILES) {
+            return "deal pile out of bounds";
+        }
+    }
+    for (int i = 0; i < game->num_completed; i++) {
+        Pile *goal = &game->goal_piles[i];
+        if (goal->num_cards != 13) {
+            return "goal pile out of bounds";
+        }
+        for (int j = 0; j < 13; j++) {
+            if (goal->cards[j].rank != 12 - j || goal->cards[j].suit != goal->cards[0].suit) {
+                return "goal pile out of order";
+            }
+        }
+    }
+    int counts[52];
+    count_cards(game, counts);
+    if (memcmp(counts, game->counts, sizeof(counts)) != 0) {
+        return "cards gained or lost";
+    }
+
+    Position table;
+    make_position(&table, game->piles, game->deal_piles, game->num_deal_piles,
+            game->num_completed, game->pos.num_suits);
+    int total = pile_cards(&table, NUM_PILES) - table.cards;
+    if (memcmp(table.num_cards, game->pos.num_cards, NUM_PILES) != 0
+            || memcmp(table.num_facedown, game->pos.num_facedown, NUM_PILES) != 0
+            || memcmp(table.cards, game->pos.cards, total) != 0
+            || table.num_deals != game->pos.num_deals
+            || table.num_completed != game->pos.num_completed) {
+        return "table and solver disagree";
+    }
+    return NULL;
+}
+
+/*
+ * Makes the move both ways and checks the result, returning what went
+ * wrong if anything did.
+ */
+static const char *step(Game *game, Move move)
+{
+    apply_move(&game->pos, move);
+    play_move(game->piles, game->deal_piles, game->goal_piles, &game->num_deal_piles,
+            &game->num_completed, move);
+    return check_game(game);
+}
+
+static bool option(const char *name, const char *value)
+{
+    if (strcmp(name, "--suits") != 0) {
+        return false;
+    }
+    num_suits = atoi(value);
+    return num_suits == 1 || num_suits == 2 || num_suits == 4;
+}
+
+static int play_random(void *state, uint64_t *random, void *moves_out, const char **error)
+{
+    Game *game = state;
+    Move *line = moves_out;
+    Move moves[MAX_MOVES];
+    int num_moves = legal_moves(&game->pos, moves);
+    if (num_moves == 0) {
+        return 0;
+    }
+    /*
+     * Also check the game turns down a move the solver wouldn't list,
+     * which random play alone never tries. One it allows goes on the end
+     * of the line, where shrinking finds it.
+     */
+    Move other = { fuzz_random(random) % NUM_PILES, fuzz_random(random) % NUM_PILES,
+        1 + fuzz_random(random) % 13 };
+    *error = check_rules(game, other);
+    if (*error) {
+        line[0] = other;
+        return 1;
+    }
+    line[0] = moves[fuzz_random(random) % num_moves];
+    *error = check_rules(game, line[0]);
+    *error = *error ? *error : step(game, line[0]);
+    return 1;
+}
+
+static const char *play(void *state, const void *move_in, bool *illegal)
+{
+    Game *game = state;
+    Move move = *(const Move *)move_in;
+    const char *error = check_rules(game, move);
+    if (!error && !is_legal_move(&game->pos, move)) {
+        *illegal = true;
+        return NULL;
+    }
+    return error ? error : step(game, move);
+}
+
+static void format(const void *move_in, char text[16])
+{
+    Move move = *(const Move *)move_in;
+    if (move.from == DEAL_MOVE) {
+        strcpy(text, "deal");
+    } else {
+        snprintf(text, 16, "%d>%dx%d", move.from, move.to, move.count);
+    }
+}
+
+static void start_replay(Replay *replay)
+{
+    replay->header.suits = num_suits;
+}
+
+static void record(Replay *replay, const void *move)
+{
+    replay_record(replay, *(const Move *)move);
+}
+
+int main(int argc, char **argv)
+{
+    FuzzRules rules = {
+        .name = "spider-fuzz",
+        .options = " [--suits 1|2|4]",
+        .deal_name = "seed",
+        .variant = REPLAY_SPIDER,
+        .game_size = sizeof(Game),
+        .move_size = sizeof(Move),
+        .extra_moves = 0,
+        .option = option,
+        .start = start_game,
+        .play_random = play_random,
+        .play = play,
+        .format = format,
+        .start_replay = start_replay,
+        .record = record,
+    };
+    return fuzz_main(&rules, argc, argv);
+}
@@ -1,10 +1,10 @@
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
-#include <assert.h>
 #include <stdbool.h>
 #include <stdio.h>
 
 #include "graphics.h"
+#include "layout.h"
 
 SDL_Texture * load_texture(Graphics *graphics, char *filename)
 {
@@ -129,104 +129,40 @@ void draw_card(Graphics *graphics, Card *card, SDL_Rect *rect)
 }
 
 /*
- * Get the index of the last facedown card in the pile.
+ * Where a card of a pile is drawn. For an empty pile, card 0 is where the
+ * first card would go.
  */
-int get_facedown_idx(Pile *pile)
+SDL_Rect get_card_rect(Graphics *graphics, Pile *pile, SDL_Rect *rect, int card_idx)
 {
-    int i = 0;
-    for (; i < pile->num_cards && pile->cards[i].orientation == FACEDOWN; i++)
-        ; /* Do nothing */
-    return i;
-}
-
-int get_card_y(Graphics *graphics, Pile *pile, SDL_Rect *rect, int card_idx) {
-    int facedown_offset = graphics->margin; /* Facedown cards */
-    int faceup_offset = graphics->margin * 4;
-
-    /* Where is the divide between facedown and faceup cards? */
-    int facedown_idx = get_facedown_idx(pile);
-
-    /* How much vertical space will this take up? */ 
-    int y = facedown_offset * facedown_idx +
-        faceup_offset * (pile->num_cards - facedown_idx - 1) +
-        graphics->card_h;
-
-    int base = facedown_idx * facedown_offset;
-
-    /*
-     * If it's going to take up too much space, set the offsets lower to
-     * compress the pile
-     */
-    if (y > rect->h) {
-        int divisor = (pile->num_cards - facedown_idx - 1);
-        divisor = divisor <= 0 ? 1 : divisor;
-        faceup_offset = (rect->h - base - graphics->card_h) / divisor;
-    }
-
-    if (card_idx < facedown_idx) {
-        return graphics->margin + card_idx * facedown_offset;
-    }
-    return graphics->margin + facedown_idx * facedown_offset +
-        (card_idx - facedown_idx) * faceup_offset;
+    return make_rect(
+            rect->x + graphics->margin,
+            rect->y + get_card_y(graphics, pile, rect, card_idx),
+            graphics->card_w - (2 * graphics->margin),
+            graphics->card_h - (2 * graphics->margin));
 }
 
 void draw_pile(Graphics *graphics, Pile *pile, SDL_Rect *rect)
 {
     for (int i = 0; i < pile->num_cards; i++) {
-        SDL_Rect dstrect = make_rect(
-                rect->x + graphics->margin,
-                rect->y + get_card_y(graphics, pile, rect, i),
-                graphics->card_w - (2 * graphics->margin),
-                graphics->card_h - (2 * graphics->margin));
+        SDL_Rect dstrect = get_card_rect(graphics, pile, rect, i);
         draw_card(graphics, &pile->cards[i], &dstrect);
     }
 }
 
-void move_pile(Pile *srcpile, Pile *dstpile, int srcidx)
-{
-    if (srcidx < 0) {
-        return;
-    }
-    int end = srcpile->num_cards;
-    for (int i = srcidx; i < end; i++) {
-        dstpile->cards[dstpile->num_cards] =
-            srcpile->cards[i];
-        dstpile->num_cards++;
-        srcpile->num_cards--;
-    }
-    assert(srcpile->num_cards == srcidx);
-}
-
-MouseTarget get_mouse_target(
-        Graphics *graphics,
-        Pile piles[],
-        SDL_Rect rects[],
-        int num_piles)
+/*
+ * Draws a highlight around a card, leaving the draw colour as it was.
+ */
+void draw_outline(Graphics *graphics, SDL_Rect *rect)
 {
-    /* Get the index of the pile that the mouse is over */
-    int pile_idx = graphics->mouse_x / graphics->card_w;
-
-    /* Bound the result between 0 and num_piles */
-    pile_idx = (pile_idx < 0 ? 0 : pile_idx);
-    pile_idx = (pile_idx > num_piles - 1
-            ? num_piles - 1
-            : pile_idx);
-
-    Pile pile = piles[pile_idx];
-    SDL_Rect rect = rects[pile_idx];
-
-    /* Mouse position relative to the pile */
-    int mouse_rel_y = graphics->mouse_y - rect.y;
-
-    for (int i = pile.num_cards - 1; i >= 0; i--) {
-        int card_y = get_card_y(graphics, &pile, &rect, i);
-        if (mouse_rel_y > card_y && mouse_rel_y < card_y + graphics->card_h) {
-            MouseTarget result = {.pile = pile_idx, .card = i};
-            return result;
-        }
+    Uint8 r, g, b, a;
+    SDL_GetRenderDrawColor(graphics->renderer, &r, &g, &b, &a);
+    SDL_SetRenderDrawColor(graphics->renderer, 255, 220, 0, 255);
+    for (int i = 0; i < 3; i++) {
+        SDL_Rect outline = make_rect(
+                rect->x - i, rect->y - i, rect->w + 2 * i, rect->h + 2 * i);
+        SDL_RenderDrawRect(graphics->renderer, &outline);
     }
-    MouseTarget result = {.pile = pile_idx, .card = -1};
-    return result;
+    SDL_SetRenderDrawColor(graphics->renderer, r, g, b, a);
 }
 
 /* Set mouse position based on normalized x and y coordinates */
@@ -259,8 +195,8 @@ void set_mouse_target(
         int card_idx)
 {
     int y = get_card_y(graphics, pile, pile_rect, card_idx);
-    graphics->mouse_offset_x = graphics->mouse_x - pile->rect.x;
-    graphics->mouse_offset_y = graphics->margin + graphics->mouse_y - (pile->rect.y + y);
+    graphics->mouse_offset_x = graphics->mouse_x - pile_rect->x;
+    graphics->mouse_offset_y = graphics->margin + graphics->mouse_y - (pile_rect->y + y);
 }
 
 void update_mouse_pile(Graphics *graphics, SDL_Rect *mouse_pile_rect)
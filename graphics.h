@@ -51,33 +51,13 @@ typedef struct {
     int h;
 } CardSize;
 
-/* A pile of cards */
-typedef struct {
-    /* There will never be more than 2 decks of cards in a pile */
-    Card cards[104];
-    int num_cards;
-    SDL_Rect rect;
-} Pile;
-
-/*
- * The indices of the pile and card currently targeted by the mouse.
- */
-typedef struct {
-    int pile;
-    int card;
-} MouseTarget;
-
 int graphics_init(Graphics *graphics, char *name);
 void graphics_free(Graphics *graphics);
 SDL_Rect make_rect(int x, int y, int w, int h);
 void draw_card(Graphics *graphics, Card *card, SDL_Rect *rect);
 void draw_pile(Graphics *graphics, Pile *pile, SDL_Rect *rect);
-void move_pile(Pile *srcpile, Pile *dstpile, int srcidx);
-MouseTarget get_mouse_target(
-        Graphics *graphics,
-        Pile piles[],
-        SDL_Rect rects[],
-        int num_piles);
+SDL_Rect get_card_rect(Graphics *graphics, Pile *pile, SDL_Rect *rect, int card_idx);
+void draw_outline(Graphics *graphics, SDL_Rect *rect);
 void set_norm_mouse_pos(Graphics *graphics, float x, float y);
 void update_graphics(Graphics *graphics, int num_piles);
 void set_mouse_target(
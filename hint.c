@@ -0,0 +1,129 @@
+#include <SDL2/SDL.h>
+#include <string.h>
+
+#include "hint.h"
+#include "table.h"
+
+/* How far a hint looks ahead */
+#define HINT_DEPTH 6
+#define HINT_MAX_NODES 1000000
+
+static int hint_thread(void *data)
+{
+    HintWorker *worker = data;
+    SDL_LockMutex(worker->lock);
+    while (!worker->quit) {
+        if (!worker->has_request) {
+            SDL_CondWait(worker->wake, worker->lock);
+            continue;
+        }
+        Position pos = worker->request;
+        int generation = worker->generation;
+        worker->has_request = false;
+        atomic_store(&worker->cancel, 0);
+        SDL_UnlockMutex(worker->lock);
+
+        SearchOptions options = { HINT_DEPTH, HINT_MAX_NODES, &worker->cancel };
+        SearchResult result = search(&pos, options);
+
+        SDL_LockMutex(worker->lock);
+        /* Anything asked for since makes this answer stale */
+        if (result.found && !result.cancelled && generation == worker->generation) {
+            worker->has_result = true;
+            worker->result_generation = generation;
+            worker->result = result.best;
+        }
+    }
+    SDL_UnlockMutex(worker->lock);
+    return 0;
+}
+
+bool hint_init(HintWorker *worker)
+{
+    memset(worker, 0, sizeof(*worker));
+    atomic_init(&worker->cancel, 0);
+    worker->lock = SDL_CreateMutex();
+    worker->wake = SDL_CreateCond();
+    worker->thread = SDL_CreateThread(hint_thread, "hint", worker);
+    if (worker->thread == NULL) {
+        SDL_Log("Failed to start hint thread: %s", SDL_GetError());
+        SDL_DestroyCond(worker->wake);
+        SDL_DestroyMutex(worker->lock);
+        return false;
+    }
+    return true;
+}
+
+void hint_free(HintWorker *worker)
+{
+    SDL_LockMutex(worker->lock);
+    worker->quit = true;
+    atomic_store(&worker->cancel, 1);
+    SDL_CondSignal(worker->wake);
+    SDL_UnlockMutex(worker->lock);
+    SDL_WaitThread(worker->thread, NULL);
+    SDL_DestroyCond(worker->wake);
+    SDL_DestroyMutex(worker->lock);
+}
+
+/*
+ * Starts looking for a hint for the table as it is, dropping any search
+ * already under way. The lock is only ever held briefly by the worker, so
+ * this doesn't wait on a search.
+ */
+void hint_request(
+        HintWorker *worker,
+        Pile piles[],
+        Pile deal_piles[],
+        int num_deal_piles,
+        int num_completed,
+        int num_suits)
+{
+    Position pos;
+    make_position(&pos, piles, deal_piles, num_deal_piles, num_completed, num_suits);
+
+    SDL_LockMutex(worker->lock);
+    worker->request = pos;
+    worker->has_request = true;
+    worker->has_result = false;
+    worker->generation++;
+    /*
+     * Set under the lock, so the worker can't clear it by picking up an
+     * older request in between
+     */
+    atomic_store(&worker->cancel, 1);
+    SDL_CondSignal(worker->wake);
+    SDL_UnlockMutex(worker->lock);
+}
+
+/*
+ * Stops the search and forgets any hint not yet picked up, for when the
+ * table has changed.
+ */
+void hint_cancel(HintWorker *worker)
+{
+    SDL_LockMutex(worker->lock);
+    worker->has_request = false;
+    worker->has_result = false;
+    worker->generation++;
+    atomic_store(&worker->cancel, 1);
+    SDL_UnlockMutex(worker->lock);
+}
+
+/*
+ * Takes the hint if one is ready. If the worker happens to hold the lock,
+ * this gives up until the next frame rather than wait.
+ */
+bool hint_poll(HintWorker *worker, Move *move)
+{
+    if (SDL_TryLockMutex(worker->lock) != 0) {
+        return false;
+    }
+    bool ready = worker->has_result && worker->result_generation == worker->generation;
+    if (ready) {
+        *move = worker->result;
+        worker->has_result = false;
+    }
+    SDL_UnlockMutex(worker->lock);
+    return ready;
+}
@@ -0,0 +1,45 @@
+#ifndef HINT_H
+#define HINT_H
+
+#include <SDL2/SDL.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+
+#include "graphics.h"
+#include "solver.h"
+
+/*
+ * Searches for hints on a thread of its own. The frame loop posts positions
+ * and polls for the answer, and never waits for the search.
+ */
+typedef struct {
+    SDL_Thread *thread;
+    SDL_mutex *lock;
+    SDL_cond *wake;
+    /* Set to stop the search in progress */
+    atomic_int cancel;
+
+    /* Everything below is guarded by lock */
+    bool quit;
+    bool has_request;
+    Position request;
+    /* Bumped on every request and cancel, so stale answers can be told apart */
+    int generation;
+    bool has_result;
+    int result_generation;
+    Move result;
+} HintWorker;
+
+bool hint_init(HintWorker *worker);
+void hint_free(HintWorker *worker);
+void hint_request(
+        HintWorker *worker,
+        Pile piles[],
+        Pile deal_piles[],
+        int num_deal_piles,
+        int num_completed,
+        int num_suits);
+void hint_cancel(HintWorker *worker);
+bool hint_poll(HintWorker *worker, Move *move);
+
+#endif
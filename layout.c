@@ -0,0 +1,75 @@
+#include "layout.h"
+
+/*
+ * Get the index of the last facedown card in the pile.
+ */
+int get_facedown_idx(Pile *pile)
+{
+    int i = 0;
+    for (; i < pile->num_cards && pile->cards[i].orientation == FACEDOWN; i++)
+        ; /* Do nothing */
+    return i;
+}
+
+int get_card_y(Graphics *graphics, Pile *pile, SDL_Rect *rect, int card_idx) {
+    int facedown_offset = graphics->margin; /* Facedown cards */
+    int faceup_offset = graphics->margin * 4;
+
+    /* Where is the divide between facedown and faceup cards? */
+    int facedown_idx = get_facedown_idx(pile);
+
+    /* How much vertical space will this take up? */ 
+    int y = facedown_offset * facedown_idx +
+        faceup_offset * (pile->num_cards - facedown_idx - 1) +
+        graphics->card_h;
+
+    int base = facedown_idx * facedown_offset;
+
+    /*
+     * If it's going to take up too much space, set the offsets lower to
+     * compress the pile
+     */
+    if (y > rect->h) {
+        int divisor = (pile->num_cards - facedown_idx - 1);
+        divisor = divisor <= 0 ? 1 : divisor;
+        faceup_offset = (rect->h - base - graphics->card_h) / divisor;
+    }
+
+    if (card_idx < facedown_idx) {
+        return graphics->margin + card_idx * facedown_offset;
+    }
+    return graphics->margin + facedown_idx * facedown_offset +
+        (card_idx - facedown_idx) * faceup_offset;
+}
+
+MouseTarget get_mouse_target(
+        Graphics *graphics,
+        Pile piles[],
+        SDL_Rect rects[],
+        int num_piles)
+{
+    /* Get the index of the pile that the mouse is over */
+    int pile_idx = graphics->mouse_x / graphics->card_w;
+
+    /* Bound the result between 0 and num_piles */
+    pile_idx = (pile_idx < 0 ? 0 : pile_idx);
+    pile_idx = (pile_idx > num_piles - 1
+            ? num_piles - 1
+            : pile_idx);
+
+    Pile pile = piles[pile_idx];
+    SDL_Rect rect = rects[pile_idx];
+
+    /* Mouse position relative to the pile */
+    int mouse_rel_y = graphics->mouse_y - rect.y;
+
+    for (int i = pile.num_cards - 1; i >= 0; i--) {
+        int card_y = get_card_y(graphics, &pile, &rect, i);
+        if (mouse_rel_y > card_y && mouse_rel_y < card_y + graphics->card_h) {
+            MouseTarget result = {.pile = pile_idx, .card = i};
+            return result;
+        }
+    }
+    MouseTarget result = {.pile = pile_idx, .card = -1};
+    return result;
+}
@@ -0,0 +1,27 @@
+#ifndef LAYOUT_H
+#define LAYOUT_H
+
+#include "graphics.h"
+
+/*
+ * Where cards sit on the table and which one the mouse is over. Only
+ * arithmetic on SDL's types, so it links without SDL's library.
+ */
+
+/*
+ * The indices of the pile and card currently targeted by the mouse.
+ */
+typedef struct {
+    int pile;
+    int card;
+} MouseTarget;
+
+int get_facedown_idx(Pile *pile);
+int get_card_y(Graphics *graphics, Pile *pile, SDL_Rect *rect, int card_idx);
+MouseTarget get_mouse_target(
+        Graphics *graphics,
+        Pile piles[],
+        SDL_Rect rects[],
+        int num_piles);
+
+#endif
@@ -0,0 +1,24 @@
+#include "replay.h"
+
+void replay_record(Replay *replay, Move move)
+{
+    int from = move.from == DEAL_MOVE ? REPLAY_DEAL : move.from;
+    replay_record_value(replay, from | (move.to & 0xf) << 4 | (move.count - 1) << 8);
+}
+
+/*
+ * Decodes the move at *pos and steps past it. False once the moves run out
+ * or if the last one is cut short.
+ */
+bool replay_next(Replay *replay, size_t *pos, Move *move)
+{
+    uint32_t value;
+    if (!replay_next_value(replay, pos, &value)) {
+        return false;
+    }
+    int from = value & 0xf;
+    move->from = from == REPLAY_DEAL ? DEAL_MOVE : from;
+    move->to = value >> 4 & 0xf;
+    move->count = (value >> 8) + 1;
+    return true;
+}
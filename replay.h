@@ -0,0 +1,19 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "common/replay_format.h"
+#include "solver.h"
+
+/*
+ * Spider's moves in the replay format shared with FreeCell (see
+ * common/replay_format.h), each packed as from | to << 4 | (count - 1) << 8.
+ * A deal is recorded with from REPLAY_DEAL.
+ */
+
+/* Pile number that stands for DEAL_MOVE in a replay */
+#define REPLAY_DEAL 15
+
+void replay_record(Replay *replay, Move move);
+bool replay_next(Replay *replay, size_t *pos, Move *move);
+
+#endif
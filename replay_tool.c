@@ -0,0 +1,129 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "replay.h"
+#include "solver.h"
+
+/*
+ * Plays Spider replays back through the rules without SDL. The FreeCell
+ * counterpart is freecell/freecell-replay.
+ */
+
+static void usage()
+{
+    printf("usage: spider-replay [--quiet] [--repeat N] FILE\n");
+    printf("Plays every game in FILE back through the rules, checking each move, and reports\n");
+    printf("how it ended. --repeat plays them N times over, for timing.\n");
+}
+
+/*
+ * Plays the game from its seed, stopping at the first move the rules don't
+ * allow. Returns how it ended, with *played the number of moves made.
+ */
+static const char *play(Replay *replay, uint32_t *played)
+{
+    Position pos;
+    deal_position(&pos, replay->header.seed, replay->header.suits ? replay->header.suits : 4);
+    size_t at = 0;
+    Move move;
+    *played = 0;
+    while (replay_next(replay, &at, &move)) {
+        if (!is_legal_move(&pos, move)) {
+            return "illegal";
+        }
+        apply_move(&pos, move);
+        (*played)++;
+    }
+    if (*played != replay->header.num_moves) {
+        return "illegal";
+    }
+    return pos.num_completed == NUM_COMPLETE ? "won" : "unfinished";
+}
+
+int main(int argc, char **argv)
+{
+    bool quiet = false;
+    long repeat = 1;
+    const char *path = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--quiet") == 0) {
+            quiet = true;
+        } else if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+            repeat = atol(argv[++i]);
+        } else if (argv[i][0] != '-' && !path) {
+            path = argv[i];
+        } else {
+            usage();
+            return 1;
+        }
+    }
+    if (!path || repeat < 1) {
+        usage();
+        return 1;
+    }
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "couldn't open %s\n", path);
+        return 1;
+    }
+
+    /* Every game is read in first so that only playback is timed */
+    Replay *games = NULL;
+    int num_games = 0;
+    int status;
+    for (;;) {
+        games = realloc(games, (num_games + 1) * sizeof(Replay));
+        memset(&games[num_games], 0, sizeof(Replay));
+        status = replay_read(&games[num_games], f);
+        if (status <= 0) {
+            break;
+        }
+        num_games++;
+    }
+    replay_free(&games[num_games]);
+    fclose(f);
+    if (status < 0) {
+        fprintf(stderr, "%s: game %d is not a replay\n", path, num_games + 1);
+    }
+
+    int bad = 0;
+    long total_moves = 0;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long r = 0; r < repeat; r++) {
+        for (int i = 0; i < num_games; i++) {
+            Replay *replay = &games[i];
+            if (replay->header.variant != REPLAY_SPIDER) {
+                if (r == 0 && !quiet) {
+                    printf("%d skipped, not a Spider game\n", i + 1);
+                }
+                continue;
+            }
+            uint32_t played;
+            const char *result = play(replay, &played);
+            total_moves += played;
+            bool illegal = strcmp(result, "illegal") == 0;
+            if (r == 0) {
+                bad += illegal;
+                if (!quiet || illegal) {
+                    printf("%d seed=%u suits=%d %s moves=%u/%u\n", i + 1,
+                            replay->header.seed,
+                            replay->header.suits ? replay->header.suits : 4,
+                            result, played, replay->header.num_moves);
+                }
+            }
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    fprintf(stderr, "%d games, %ld moves in %.3f s, %.0f moves/s\n", num_games, total_moves,
+            seconds, seconds > 0 ? total_moves / seconds : 0.0);
+    for (int i = 0; i < num_games; i++) {
+        replay_free(&games[i]);
+    }
+    free(games);
+    return bad > 0 || status < 0 ? 2 : 0;
+}
@@ -0,0 +1,153 @@
+#include <assert.h>
+#include <stdbool.h>
+
+#include "rules.h"
+
+/*
+ * Whether or not a card pile can be picked up
+ */
+int can_pick_up(Pile *src, int idx)
+{
+    /* Don't allow moving facedown cards */
+    if (src->cards[idx].orientation == FACEDOWN) {
+        return false;
+    }
+    Card *prev_card;
+    Card *curr_card;
+    for (int i = idx; i < src->num_cards - 1; i++) {
+        prev_card = &src->cards[i];
+        curr_card = &src->cards[i + 1];
+        if (curr_card->suit != prev_card->suit
+                || curr_card->rank != prev_card->rank - 1) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * Whether or not a card pile can be set down
+ */
+int can_place(Pile *src, Pile *dst)
+{
+    /* An empty pile has no top card to look at */
+    if (dst->num_cards == 0) {
+        return true;
+    }
+    int src_val = src->cards[0].rank;
+    int dst_val = dst->cards[dst->num_cards - 1].rank;
+    return src_val == dst_val - 1;
+}
+
+/*
+ * Deals the next set of cards and returns the remaining number of piles to
+ * be dealt.
+ */
+int deal_next_set(
+        Pile piles[],
+        Pile deal_piles[],
+        int num_piles,
+        int num_deal_piles)
+{
+    /* Don't deal if there are empty spaces */
+    int i = 0;
+    for (; i < num_piles; i++) {
+        if (piles[i].num_cards == 0) {
+            return num_deal_piles;
+        }
+    }
+    if (num_deal_piles > 0) {
+        i = 0;
+        Pile *xs = &deal_piles[num_deal_piles - 1];
+        for (; xs->num_cards > 0; i++) {
+            Pile *s = &piles[i % num_piles];
+            s->cards[s->num_cards] = xs->cards[xs->num_cards - 1];
+            s->cards[s->num_cards].orientation = FACEUP;
+            s->num_cards++;
+            xs->num_cards--;
+        }
+    }
+    return num_deal_piles - 1;
+}
+
+/*
+ * Checks if the source pile contains a full series from king to ace of one 
+ * suit. If so, it moves the series to the destination pile, and returns
+ * true. Otherwise it returns false.
+ */
+int check_complete(Pile *srcpile, Pile *dstpile)
+{
+    for (int i = 0; i < srcpile->num_cards; i++) {
+        if (srcpile->cards[i].rank == 12
+                && srcpile->cards[i].orientation == FACEUP) {
+            /* We found a king, face up so that it can be part of a run */
+            int j = i + 1;
+            int target_rank = 11;
+            int target_suit = srcpile->cards[i].suit;
+            /*
+             * Crawl down the pile to see if it's complete and in
+             * descending order
+             */
+            while (j < srcpile->num_cards) {
+                if (srcpile->cards[j].rank != target_rank
+
+
+                        || srcpile->cards[j].suit  != target_suit) {
+                    break;
+                }
+                if (target_rank == 0 && j == srcpile->num_cards - 1) {
+                    /* We made it to the ace, at the top of the pile */
+                    move_pile(srcpile, dstpile, i);
+                    if (srcpile->num_cards > 0) {
+                        srcpile->cards[i - 1].orientation = FACEUP;
+                    }
+                    return true;
+                }
+                target_rank--;
+                j++;
+            }
+        }
+    }
+    return false;
+}
+
+/*
+ * Makes a move from a replay on the table, as if it had been played by
+ * hand. The move must be legal.
+ */
+void play_move(
+        Pile piles[],
+        Pile deal_piles[],
+        Pile goal_piles[],
+        int *num_deal_piles,
+        int *num_completed_piles,
+        Move move)
+{
+    if (move.from == DEAL_MOVE) {
+        *num_deal_piles = deal_next_set(piles, deal_piles, NUM_PILES, *num_deal_piles);
+        return;
+    }
+    Pile *src = &piles[move.from];
+    move_pile(src, &piles[move.to], src->num_cards - move.count);
+    if (src->num_cards > 0) {
+        src->cards[src->num_cards - 1].orientation = FACEUP;
+    }
+    if (check_complete(&piles[move.to], &goal_piles[*num_completed_piles])) {
+        (*num_completed_piles)++;
+    }
+}
+
+void move_pile(Pile *srcpile, Pile *dstpile, int srcidx)
+{
+    if (srcidx < 0) {
+        return;
+    }
+    int end = srcpile->num_cards;
+    for (int i = srcidx; i < end; i++) {
+        dstpile->cards[dstpile->num_cards] =
+            srcpile->cards[i];
+        dstpile->num_cards++;
+        srcpile->num_cards--;
+    }
+    assert(srcpile->num_cards == srcidx);
+}
@@ -0,0 +1,29 @@
+#ifndef RULES_H
+#define RULES_H
+
+#include "cards.h"
+#include "solver.h"
+
+/*
+ * Spider's rules on the table as it is drawn, card by card. The solver keeps
+ * its own copy of them over Position.
+ */
+
+int can_pick_up(Pile *src, int idx);
+int can_place(Pile *src, Pile *dst);
+int deal_next_set(
+        Pile piles[],
+        Pile deal_piles[],
+        int num_piles,
+        int num_deal_piles);
+int check_complete(Pile *srcpile, Pile *dstpile);
+void play_move(
+        Pile piles[],
+        Pile deal_piles[],
+        Pile goal_piles[],
+        int *num_deal_piles,
+        int *num_completed_piles,
+        Move move);
+void move_pile(Pile *srcpile, Pile *dstpile, int srcidx);
+
+#endif
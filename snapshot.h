@@ -0,0 +1,32 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "solver.h"
+
+/*
+ * A game in progress, saved so that closing the game doesn't lose it. The
+ * file is exactly one Snapshot, in the byte order of the machine that wrote
+ * it, and one that doesn't match in magic, version or size is ignored.
+ */
+
+#define SNAPSHOT_MAGIC 0x4e535053 /* "SPSN" */
+#define SNAPSHOT_VERSION 2
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t size; /* sizeof(Snapshot) */
+    uint32_t seed; /* What the game was dealt from */
+    /* The piles and deal piles, with the counters of both kinds of pile */
+    Position table;
+    /* Suit of each completed series, in the order they were completed */
+    uint8_t goal_suits[NUM_COMPLETE];
+} Snapshot;
+
+bool snapshot_save(const char *path, Snapshot *snapshot);
+bool snapshot_load(const char *path, Snapshot *snapshot);
+
+#endif
@@ -0,0 +1,188 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "solver.h"
+
+/*
+ * Plays Spider deals out with the solver, without SDL.
+ */
+
+/* Moves a game played by hints gives up after, as hints can go round */
+#define MAX_HINT_MOVES 1000
+
+static void usage()
+{
+    printf("usage: spider-solve [--suits 1|2|4] [--width W] [--depth D] [--max-nodes N]\n");
+    printf("                    [--max-ms MS] [--weights C,E,F,R,S] [--hints]\n");
+    printf("                    [--verbose] SEED|--range FIRST-LAST\n");
+    printf("Plays each deal by beam search, W positions wide and D moves deep, until it is\n");
+    printf("won or no line improves on the position. The weights score completed suits, empty piles,\n");
+    printf("face-down cards, suited runs and cards left in the stock. --hints plays the hint\n");
+    printf("the game would give instead, looking D moves ahead, at most N nodes per move.\n");
+    printf("Reports how many moves each pruning rule skipped.\n");
+}
+
+static void print_move(Move move)
+{
+    if (move.from == DEAL_MOVE) {
+        printf("deal\n");
+    } else {
+        printf("%d -> %d x%d\n", move.from, move.to, move.count);
+    }
+}
+
+/*
+ * Searches from the deal and plays the best line found, again from where
+ * that leaves off until nothing improves on the position. Every line scores
+ * better than the last, so this can't go round in circles. Returns whether
+ * the game was won.
+ */
+static bool play(
+        uint32_t seed,
+        int suits,
+        BeamOptions options,
+        bool verbose,
+        long *nodes,
+        int *moves,
+        long pruned[])
+{
+    Position pos;
+    deal_position(&pos, seed, suits);
+    *nodes = 0;
+    *moves = 0;
+    while (pos.num_completed < NUM_COMPLETE) {
+        BeamResult result = beam_search(&pos, options);
+        *nodes += result.nodes;
+        for (int i = 0; i < NUM_PRUNE_RULES; i++) {
+            pruned[i] += result.pruned[i];
+        }
+        if (!result.found) {
+            break;
+        }
+        for (int i = 0; i < result.num_moves; i++) {
+            if (verbose) {
+                print_move(result.moves[i]);
+            }
+            apply_move(&pos, result.moves[i]);
+        }
+        *moves += result.num_moves;
+    }
+    return pos.num_completed == NUM_COMPLETE;
+}
+
+/*
+ * Plays the deal by taking one hint after another, the way the game finds
+ * them, until there is none or the game has gone on too long.
+ */
+static bool play_hints(
+        uint32_t seed,
+        int suits,
+        SearchOptions options,
+        bool verbose,
+        long *nodes,
+        int *moves,
+        long pruned[])
+{
+    Position pos;
+    deal_position(&pos, seed, suits);
+    *nodes = 0;
+    *moves = 0;
+    while (pos.num_completed < NUM_COMPLETE && *moves < MAX_HINT_MOVES) {
+        SearchResult result = search(&pos, options);
+        *nodes += result.nodes;
+        for (int i = 0; i < NUM_PRUNE_RULES; i++) {
+            pruned[i] += result.pruned[i];
+        }
+        if (!result.found) {
+            break;
+        }
+        if (verbose) {
+            print_move(result.best);
+        }
+        apply_move(&pos, result.best);
+        (*moves)++;
+    }
+    return pos.num_completed == NUM_COMPLETE;
+}
+
+int main(int argc, char **argv)
+{
+    BeamOptions options = { 64, BEAM_MAX_DEPTH, 0, 1000, PLAY_WEIGHTS, NULL };
+    int suits = 4;
+    long first = -1, last = -1;
+    bool verbose = false;
+    bool hints = false;
+    bool depth_set = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--suits") == 0 && i + 1 < argc) {
+            suits = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--width") == 0 && i + 1 < argc) {
+            options.width = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--depth") == 0 && i + 1 < argc) {
+            options.max_depth = atoi(argv[++i]);
+            depth_set = true;
+        } else if (strcmp(argv[i], "--max-nodes") == 0 && i + 1 < argc) {
+            options.max_nodes = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--max-ms") == 0 && i + 1 < argc) {
+            options.max_ms = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--weights") == 0 && i + 1 < argc) {
+            EvalWeights *w = &options.weights;
+            if (sscanf(argv[++i], "%d,%d,%d,%d,%d", &w->completed, &w->empty,
+                        &w->facedown, &w->run, &w->stock) != 5) {
+                usage();
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--hints") == 0) {
+            hints = true;
+        } else if (strcmp(argv[i], "--verbose") == 0) {
+            verbose = true;
+        } else if (strcmp(argv[i], "--range") == 0 && i + 1 < argc) {
+            if (sscanf(argv[++i], "%ld-%ld", &first, &last) != 2) {
+                usage();
+                return 1;
+            }
+        } else if (argv[i][0] != '-') {
+            first = last = atol(argv[i]);
+        } else {
+            usage();
+            return 1;
+        }
+    }
+    if (first < 0 || last < first || (suits != 1 && suits != 2 && suits != 4)) {
+        usage();
+        return 1;
+    }
+
+    /* The same look-ahead and node limit as the game's hints */
+    SearchOptions hint_options = { depth_set ? options.max_depth : 6,
+        options.max_nodes > 0 ? options.max_nodes : 1000000, NULL };
+
+    int won = 0;
+    long pruned[NUM_PRUNE_RULES] = {0};
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long seed = first; seed <= last; seed++) {
+        struct timespec t0, t1;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        long nodes;
+        int moves;
+        bool result = hints
+            ? play_hints(seed, suits, hint_options, verbose, &nodes, &moves, pruned)
+            : play(seed, suits, options, verbose, &nodes, &moves, pruned);
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        long ms = (t1.tv_sec - t0.tv_sec) * 1000 + (t1.tv_nsec - t0.tv_nsec) / 1000000;
+        printf("%ld %s moves=%d nodes=%ld ms=%ld\n", seed, result ? "won" : "lost", moves, nodes, ms);
+        won += result;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    fprintf(stderr, "%d of %ld won in %.1f s\n", won, last - first + 1, seconds);
+    fprintf(stderr, "pruned");
+    for (int i = 0; i < NUM_PRUNE_RULES; i++) {
+        fprintf(stderr, " %s=%ld", prune_rule_name(i), pruned[i]);
+    }
+    fprintf(stderr, "\n");
+    return 0;
+}
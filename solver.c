@@ -0,0 +1,503 @@
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "solver.h"
+
+/*
+ * Deals a new game from a seed. The shuffle has a generator of its own, the
+ * same one Microsoft FreeCell deals with, so that a seed is the same game
+ * everywhere and a replay need only record the seed. The first four piles
+ * get six cards and the rest five, all but the top one face down, and the
+ * other fifty go to the stock. num_suits must be 1, 2 or 4, with the eight
+ * runs of cards split evenly between the suits.
+ */
+void deal_position(Position *pos, uint32_t seed, int num_suits)
+{
+    /* Two suits are 0 and 2, one black and one red */
+    uint8_t deck[DECK_SIZE];
+    for (int i = 0; i < DECK_SIZE; i++) {
+        deck[i] = (i / 13 % num_suits) * (4 / num_suits) * 13 + i % 13;
+    }
+    for (int i = DECK_SIZE - 1; i > 0; i--) {
+        seed = (seed * 214013 + 2531011) & 0x7fffffff;
+        int j = ((seed >> 16) & 0x7fff) % (i + 1);
+        uint8_t card = deck[i];
+        deck[i] = deck[j];
+        deck[j] = card;
+    }
+
+    memset(pos, 0, sizeof(*pos));
+    int n = 0;
+    for (int i = 0; i < NUM_PILES; i++) {
+        int len = i < 4 ? 6 : 5;
+        memcpy(&pos->cards[n], &deck[n], len);
+        pos->num_cards[i] = len;
+        pos->num_facedown[i] = len - 1;
+        n += len;
+    }
+    memcpy(pos->stock, &deck[n], DECK_SIZE - n);
+    pos->num_deals = NUM_DEALS;
+    pos->num_suits = num_suits;
+}
+
+/*
+ * The bottom card of a pile, with the rest above it.
+ */
+uint8_t *pile_cards(Position *pos, int pile)
+{
+    int start = 0;
+    for (int i = 0; i < pile; i++) {
+        start += pos->num_cards[i];
+    }
+    return &pos->cards[start];
+}
+
+/*
+ * Turns the top card of a pile face up if it is face down.
+ */
+static void flip_top(Position *pos, int pile)
+{
+    if (pos->num_cards[pile] > 0
+            && pos->num_facedown[pile] == pos->num_cards[pile]) {
+        pos->num_facedown[pile]--;
+    }
+}
+
+/*
+ * Removes the top count cards of a pile, closing the gap in the card array.
+ */
+static void take_cards(Position *pos, int pile, int count, uint8_t out[])
+{
+    uint8_t *top = pile_cards(pos, pile) + pos->num_cards[pile];
+    uint8_t *end = pile_cards(pos, NUM_PILES);
+    if (out) {
+        memcpy(out, top - count, count);
+    }
+    memmove(top - count, top, end - top);
+    pos->num_cards[pile] -= count;
+}
+
+static void put_cards(Position *pos, int pile, int count, uint8_t cards[])
+{
+    uint8_t *top = pile_cards(pos, pile) + pos->num_cards[pile];
+    uint8_t *end = pile_cards(pos, NUM_PILES);
+    memmove(top + count, top, end - top);
+    memcpy(top, cards, count);
+    pos->num_cards[pile] += count;
+}
+
+/*
+ * The first empty pile, or NUM_PILES if none is. Moving cards into any other
+ * empty pile reaches the same position with the piles in another order.
+ */
+static int first_empty_pile(Position *pos)
+{
+    int pile = 0;
+    while (pile < NUM_PILES && pos->num_cards[pile] > 0) {
+        pile++;
+    }
+    return pile;
+}
+
+/*
+ * Whether the move straight back would undo a move: it turned no card over
+ * and completed no suit, so it only shifted cards from one pile to another.
+ */
+static bool is_reversible(Position *before, Position *after, Move move)
+{
+    return move.from != DEAL_MOVE
+        && after->num_facedown[move.from] == before->num_facedown[move.from]
+        && after->num_completed == before->num_completed;
+}
+
+/*
+ * Whether a legal move can be skipped, given the move that led to the
+ * position and whether it could be undone, and if so by which rule. Runs
+ * can otherwise go back and forth between equal spots forever.
+ */
+static bool prune_move(
+        Position *pos,
+        Move move,
+        int first_empty,
+        Move last,
+        bool last_reversible,
+        PruneRule *rule)
+{
+    if (move.from == DEAL_MOVE) {
+        return false;
+    }
+    if (last_reversible && move.from == last.to && move.to == last.from
+            && move.count == last.count) {
+        *rule = PRUNE_REVERSE;
+        return true;
+    }
+    if (pos->num_cards[move.to] == 0) {
+        /* Only ever the case with nothing face down under the run */
+        if (move.count == pos->num_cards[move.from]) {
+            *rule = PRUNE_FULL_COLUMN;
+            return true;
+        }
+        if (move.to != first_empty) {
+            *rule = PRUNE_EMPTY_SYMMETRY;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char *prune_rule_name(PruneRule rule)
+{
+    switch (rule) {
+    case PRUNE_REVERSE: return "reverse";
+    case PRUNE_CYCLE: return "cycle";
+    case PRUNE_FULL_COLUMN: return "full-column";
+    case PRUNE_EMPTY_SYMMETRY: return "empty-symmetry";
+    default: return "unknown";
+    }
+}
+
+/*
+ * A position on the line the depth-first search is following, linked back
+ * to the one before it.
+ */
+typedef struct PathNode {
+    const struct PathNode *parent;
+    Position *pos;
+    Move move; /* The move that led here */
+    bool reversible; /* Whether that move could be undone */
+} PathNode;
+
+/*
+ * Whether a position reached by a reversible move is already on the line.
+ * Only positions back to the last move that can't be undone need checking,
+ * as none before it can come round again, and those all have the same cards
+ * face down and to deal, so comparing the piles is enough.
+ */
+static bool on_path(const PathNode *path, Position *pos)
+{
+    int total = pile_cards(pos, NUM_PILES) - pos->cards;
+    for (; path; path = path->reversible ? path->parent : NULL) {
+        if (memcmp(path->pos->num_cards, pos->num_cards, NUM_PILES) == 0
+                && memcmp(path->pos->cards, pos->cards, total) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+typedef struct {
+    SearchOptions options;
+    int depth_limit;
+    SearchResult result;
+} Search;
+
+static bool should_stop(Search *s)
+{
+    if (s->result.cancelled) {
+        return true;
+    }
+    if (s->options.cancel && s->result.nodes % 1024 == 0
+            && atomic_load(s->options.cancel)) {
+        s->result.cancelled = true;
+    }
+    return s->result.cancelled
+        || (s->options.max_nodes > 0 && s->result.nodes >= s->options.max_nodes);
+}
+
+const EvalWeights DEFAULT_WEIGHTS = { 1000, 50, -10, 5, 0 };
+
+/*
+ * Next to the weights hints use, these care less about keeping piles empty
+ * and more about building runs, and they push towards dealing, without which
+ * a beam holds on to its empty piles for good.
+ */
+const EvalWeights PLAY_WEIGHTS = { 1000, 5, -10, 10, -1 };
+
+/* The kernels for each variant, as legal_moves_1, legal_moves_2 and so on */
+#define KERNEL(name) KERNEL_NAME(name, SUITS)
+#define KERNEL_NAME(name, suits) KERNEL_NAME_(name, suits)
+#define KERNEL_NAME_(name, suits) name##_##suits
+
+#define SUITS 1
+#include "solver_kernels.h"
+#undef SUITS
+
+#define SUITS 2
+#include "solver_kernels.h"
+#undef SUITS
+
+#define SUITS 4
+#include "solver_kernels.h"
+#undef SUITS
+
+/* Calls the kernel for the position's number of suits */
+#define DISPATCH(pos, name, ...) \
+    ((pos)->num_suits == 1 ? name##_1(__VA_ARGS__) \
+        : (pos)->num_suits == 2 ? name##_2(__VA_ARGS__) \
+        : name##_4(__VA_ARGS__))
+
+int legal_moves(Position *pos, Move moves[])
+{
+    return DISPATCH(pos, legal_moves, pos, moves);
+}
+
+/*
+ * Whether the move is one legal_moves would give, without listing them all.
+ */
+bool is_legal_move(Position *pos, Move move)
+{
+    return DISPATCH(pos, is_legal_move, pos, move);
+}
+
+/*
+ * The move must be legal.
+ */
+void apply_move(Position *pos, Move move)
+{
+    DISPATCH(pos, apply_move, pos, move);
+}
+
+/*
+ * How promising a position looks: completed suits, cards sitting on the
+ * next lower card of their own suit, empty piles, and few cards left face
+ * down.
+ */
+int evaluate(Position *pos, const EvalWeights *weights)
+{
+    return DISPATCH(pos, evaluate, pos, weights);
+}
+
+/*
+ * Looks for the line that leads to the best evaluation, going one move
+ * deeper each pass until out of depth, nodes or time. Of equally good
+ * lines, the shortest wins. When nothing improves on the position as it
+ * is, the answer is to deal if possible, and otherwise there is none,
+ * rather than a move that only shuffles cards around.
+ */
+SearchResult search(Position *pos, SearchOptions options)
+{
+    void (*search_from)(Search *, Position *, int, Move, const PathNode *) =
+        pos->num_suits == 1 ? search_from_1
+        : pos->num_suits == 2 ? search_from_2 : search_from_4;
+    Search s = { .options = options };
+    s.result.score = INT_MIN;
+    PathNode root = { NULL, pos, {0}, false };
+    for (int depth = 1; depth <= options.max_depth && !should_stop(&s); depth++) {
+        s.depth_limit = depth;
+        search_from(&s, pos, 0, (Move){0}, &root);
+    }
+
+    bool can_deal = pos->num_deals > 0;
+    for (int i = 0; i < NUM_PILES; i++) {
+        can_deal &= pos->num_cards[i] > 0;
+    }
+    if (s.result.found && s.result.score <= evaluate(pos, &DEFAULT_WEIGHTS)) {
+        s.result.found = can_deal;
+        s.result.best = (Move){ DEAL_MOVE, 0, NUM_PILES };
+    }
+    return s.result;
+}
+
+/*
+ * A move out of one of the positions kept at the previous depth.
+ */
+typedef struct {
+    int score;
+    int parent;
+    Move move;
+} BeamCandidate;
+
+static int compare_candidates(const void *a, const void *b)
+{
+    const BeamCandidate *x = a;
+    const BeamCandidate *y = b;
+    /* Best first, and the same order every time among equals */
+    if (x->score != y->score) {
+        return x->score > y->score ? -1 : 1;
+    }
+    if (x->parent != y->parent) {
+        return x->parent - y->parent;
+    }
+    if (x->move.from != y->move.from) {
+        return x->move.from - y->move.from;
+    }
+    return x->move.to != y->move.to ? x->move.to - y->move.to : x->move.count - y->move.count;
+}
+
+/*
+ * FNV-1a over the parts of a position that tell it apart. Bytes past the
+ * last card can be left over from earlier moves, so they don't count.
+ */
+static uint64_t hash_position(Position *pos)
+{
+    int total = 0;
+    for (int i = 0; i < NUM_PILES; i++) {
+        total += pos->num_cards[i];
+    }
+    uint64_t h = 14695981039346656037ull;
+    for (int i = 0; i < total; i++) {
+        h = (h ^ pos->cards[i]) * 1099511628211ull;
+    }
+    for (int i = 0; i < NUM_PILES; i++) {
+        h = (h ^ pos->num_cards[i]) * 1099511628211ull;
+        h = (h ^ pos->num_facedown[i]) * 1099511628211ull;
+    }
+    return (h ^ pos->num_deals) * 1099511628211ull;
+}
+
+/*
+ * Adds the hash to an open-addressed set, returning false if it was already
+ * there. Zero marks an empty slot, so a hash of zero is taken as one.
+ */
+static bool insert_seen(uint64_t *seen, size_t mask, uint64_t h)
+{
+    h = h ? h : 1;
+    for (size_t i = h & mask;; i = (i + 1) & mask) {
+        if (seen[i] == h) {
+            return false;
+        }
+        if (seen[i] == 0) {
+            seen[i] = h;
+            return true;
+        }
+    }
+}
+
+static long elapsed_ms(struct timespec *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1000 + (now.tv_nsec - start->tv_nsec) / 1000000;
+}
+
+/*
+ * Breadth-first search that keeps only the width best positions at each
+ * depth, scored with the given weights, so that its cost grows with depth
+ * rather than exponentially. Moves are pruned as in the depth-first search,
+ * and positions already reached by another line are dropped, which also
+ * keeps runs from going round in circles. Returns the
+ * line to the best position seen at any depth, shortest first among equals,
+ * or the first line to win.
+ */
+BeamResult beam_search(Position *pos, BeamOptions options)
+{
+    BeamResult result = {0};
+    int width = options.width > 0 ? options.width : 1;
+    int max_depth = options.max_depth > 0 && options.max_depth < BEAM_MAX_DEPTH
+        ? options.max_depth : BEAM_MAX_DEPTH;
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    /* The beam, the one being filled, and each depth's moves for the line */
+    Position *beam = malloc(width * sizeof(Position));
+    Position *next = malloc(width * sizeof(Position));
+    /* Whether the move to each position could be undone */
+    bool *beam_reversible = malloc(width * sizeof(bool));
+    bool *next_reversible = malloc(width * sizeof(bool));
+    BeamCandidate *links = malloc((size_t)max_depth * width * sizeof(BeamCandidate));
+    size_t num_candidates = (size_t)width * 64;
+    BeamCandidate *candidates = malloc(num_candidates * sizeof(BeamCandidate));
+    size_t seen_size = 1024;
+    while (seen_size < (size_t)4 * width * max_depth) {
+        seen_size *= 2;
+    }
+    uint64_t *seen = calloc(seen_size, sizeof(uint64_t));
+
+    beam[0] = *pos;
+    beam_reversible[0] = false;
+    int beam_len = 1;
+    insert_seen(seen, seen_size - 1, hash_position(pos));
+    int root_score = evaluate(pos, &options.weights);
+    result.score = root_score;
+    int best_depth = 0;
+    int best_index = 0;
+
+    for (int depth = 0; depth < max_depth && beam_len > 0 && !result.won; depth++) {
+        /* Score every move out of the beam without keeping the positions */
+        size_t n = 0;
+        bool stop = false;
+        for (int i = 0; i < beam_len && !stop; i++) {
+            Move moves[MAX_MOVES];
+            int num_moves = legal_moves(&beam[i], moves);
+            if (n + num_moves > num_candidates) {
+                num_candidates = (n + num_moves) * 2;
+                candidates = realloc(candidates, num_candidates * sizeof(BeamCandidate));
+            }
+            Move last = depth > 0 ? links[(size_t)(depth - 1) * width + i].move : (Move){0};
+            int first_empty = first_empty_pile(&beam[i]);
+            for (int j = 0; j < num_moves; j++) {
+                PruneRule rule;
+                if (prune_move(&beam[i], moves[j], first_empty, last, beam_reversible[i], &rule)) {
+                    result.pruned[rule]++;
+                    continue;
+                }
+                Position child = beam[i];
+                apply_move(&child, moves[j]);
+                candidates[n++] = (BeamCandidate){
+                    evaluate(&child, &options.weights), i, moves[j] };
+                result.nodes++;
+            }
+            stop = (options.max_nodes > 0 && result.nodes >= options.max_nodes)
+                || (options.cancel && atomic_load(options.cancel))
+                || (options.max_ms > 0 && elapsed_ms(&start) >= options.max_ms);
+        }
+        qsort(candidates, n, sizeof(BeamCandidate), compare_candidates);
+
+        /* Keep the best that haven't been reached before */
+        int next_len = 0;
+        for (size_t c = 0; c < n && next_len < width; c++) {
+            Position child = beam[candidates[c].parent];
+            apply_move(&child, candidates[c].move);
+            if (!insert_seen(seen, seen_size - 1, hash_position(&child))) {
+                result.pruned[PRUNE_CYCLE]++;
+                continue;
+            }
+            next[next_len] = child;
+            next_reversible[next_len] =
+                is_reversible(&beam[candidates[c].parent], &child, candidates[c].move);
+            links[(size_t)depth * width + next_len] = candidates[c];
+            if (candidates[c].score > result.score || child.num_completed == NUM_COMPLETE) {
+                result.score = candidates[c].score;
+                best_depth = depth + 1;
+                best_index = next_len;
+                result.won = child.num_completed == NUM_COMPLETE;
+                if (result.won) {
+                    break;
+                }
+            }
+            next_len++;
+        }
+        Position *swap = beam;
+        beam = next;
+        next = swap;
+        bool *swap_reversible = beam_reversible;
+        beam_reversible = next_reversible;
+        next_reversible = swap_reversible;
+        beam_len = next_len;
+
+        if (stop) {
+            result.cancelled = options.cancel && atomic_load(options.cancel);
+            break;
+        }
+    }
+
+    /* Follow the line back from the best position */
+    result.found = result.score > root_score || result.won;
+    result.num_moves = best_depth;
+    for (int depth = best_depth - 1, i = best_index; depth >= 0; depth--) {
+        BeamCandidate *link = &links[(size_t)depth * width + i];
+        result.moves[depth] = link->move;
+        i = link->parent;
+    }
+
+    free(beam);
+    free(next);
+    free(beam_reversible);
+    free(next_reversible);
+    free(links);
+    free(candidates);
+    free(seen);
+    return result;
+}
@@ -0,0 +1,128 @@
+#ifndef SOLVER_H
+#define SOLVER_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Spider rules and search over a compact copy of the table, independent of
+ * SDL so that it can run on any thread.
+ */
+
+#define NUM_PILES 10
+#define NUM_DEALS 5
+#define NUM_COMPLETE 8
+#define DECK_SIZE 104
+
+/* Upper bound on the moves legal_moves can return */
+#define MAX_MOVES (NUM_PILES * 13 * (NUM_PILES - 1) + 1)
+
+/* Move.from for dealing a card onto every pile */
+#define DEAL_MOVE 0xff
+
+/*
+ * A card is one byte, suit * 13 + rank, with suits and ranks as in Card.
+ */
+typedef struct {
+    /*
+     * The cards of all the piles back to back, first pile first, each from
+     * the bottom up. The bottom num_facedown of a pile are face down.
+     */
+    uint8_t cards[DECK_SIZE];
+    uint8_t num_cards[NUM_PILES];
+    uint8_t num_facedown[NUM_PILES];
+    /*
+     * Cards still to be dealt, NUM_PILES per deal. The last deal goes out
+     * first, with stock[deal * NUM_PILES + i] going onto pile i.
+     */
+    uint8_t stock[NUM_DEALS * NUM_PILES];
+    uint8_t num_deals;
+    uint8_t num_completed;
+    uint8_t num_suits; /* 1, 2 or 4, which picks the rules kernels */
+} Position;
+
+/* Moves the top count cards of one pile onto another, or deals */
+typedef struct {
+    uint8_t from;
+    uint8_t to;
+    uint8_t count;
+} Move;
+
+/*
+ * What evaluate scores a position on, each weight per unit. Face-down cards
+ * count against it, so their weight is negative.
+ */
+typedef struct {
+    int completed; /* Suits completed */
+    int empty; /* Empty piles */
+    int facedown; /* Cards still face down */
+    int run; /* Face-up cards on the next higher card of their own suit */
+    int stock; /* Cards still to be dealt */
+} EvalWeights;
+
+/* For hints, and for playing whole games by beam search */
+extern const EvalWeights DEFAULT_WEIGHTS;
+extern const EvalWeights PLAY_WEIGHTS;
+
+/*
+ * Moves the searches skip because they can't reach a position worth having
+ * that some other move doesn't
+ */
+typedef enum {
+    PRUNE_REVERSE, /* Puts back the cards the move before it moved */
+    PRUNE_CYCLE, /* Leads back to a position on the line, or for a beam any seen */
+    PRUNE_FULL_COLUMN, /* Moves a whole pile into an empty one */
+    PRUNE_EMPTY_SYMMETRY, /* Moves into an empty pile other than the first */
+    NUM_PRUNE_RULES
+} PruneRule;
+
+typedef struct {
+    int max_depth; /* Moves to look ahead */
+    long max_nodes; /* Stop after this many positions, 0 for no limit */
+    atomic_int *cancel; /* Stop as soon as this is set, if not NULL */
+} SearchOptions;
+
+typedef struct {
+    bool found; /* Whether there was a move worth making */
+    bool cancelled;
+    Move best; /* First move of the best line found */
+    int score; /* Evaluation at the end of that line */
+    long nodes;
+    long pruned[NUM_PRUNE_RULES]; /* Moves skipped by each rule */
+} SearchResult;
+
+/* Longest line beam_search looks along */
+#define BEAM_MAX_DEPTH 512
+
+typedef struct {
+    int width; /* Positions kept at each depth */
+    int max_depth; /* Moves to look ahead, at most BEAM_MAX_DEPTH */
+    long max_nodes; /* Stop after this many positions, 0 for no limit */
+    int max_ms; /* Stop after this long, 0 for no limit */
+    EvalWeights weights;
+    atomic_int *cancel; /* Stop as soon as this is set, if not NULL */
+} BeamOptions;
+
+typedef struct {
+    bool found; /* Whether some line scores better than the position as is */
+    bool won; /* Whether the line completes every suit */
+    bool cancelled;
+    int num_moves;
+    Move moves[BEAM_MAX_DEPTH]; /* The best line found */
+    int score; /* Evaluation at the end of that line */
+    long nodes;
+    long pruned[NUM_PRUNE_RULES]; /* Moves skipped by each rule */
+} BeamResult;
+
+void deal_position(Position *pos, uint32_t seed, int num_suits);
+uint8_t *pile_cards(Position *pos, int pile);
+int legal_moves(Position *pos, Move moves[]);
+bool is_legal_move(Position *pos, Move move);
+void apply_move(Position *pos, Move move);
+int evaluate(Position *pos, const EvalWeights *weights);
+SearchResult search(Position *pos, SearchOptions options);
+BeamResult beam_search(Position *pos, BeamOptions options);
+const char *prune_rule_name(PruneRule rule);
+
+#endif
@@ -0,0 +1,211 @@
+/*
+ * The rules and search kernels, compiled once per number of suits: solver.c
+ * defines SUITS and includes this file for each variant. SUITS is a
+ * constant here, so the suit checks of the one-suit game and the division
+ * that takes a card apart fold away. Kernels are named with KERNEL(name),
+ * which appends the suit count. There is deliberately no include guard.
+ */
+
+#ifndef SUITS
+#error "define SUITS before including solver_kernels.h"
+#endif
+
+/* With one suit every card is suit 0, so a card is its own rank */
+#define K_SUIT(card) (SUITS == 1 ? 0 : (card) / 13)
+#define K_RANK(card) (SUITS == 1 ? (card) : (card) % 13)
+
+/*
+ * Length of the run at the top of a pile that could be picked up together:
+ * face up, one suit, descending by one.
+ */
+static int KERNEL(run_len)(Position *pos, uint8_t *cards, int pile)
+{
+    int len = pos->num_cards[pile];
+    int faceup = len - pos->num_facedown[pile];
+    int run = faceup > 0 ? 1 : 0;
+    while (run < faceup) {
+        uint8_t below = cards[len - run - 1];
+        uint8_t above = cards[len - run];
+        if (K_SUIT(below) != K_SUIT(above)
+                || K_RANK(above) != K_RANK(below) - 1) {
+            break;
+        }
+        run++;
+    }
+    return run;
+}
+
+static int KERNEL(legal_moves)(Position *pos, Move moves[])
+{
+    uint8_t *starts[NUM_PILES];
+    uint8_t *cards = pos->cards;
+    bool any_empty = false;
+    for (int i = 0; i < NUM_PILES; i++) {
+        starts[i] = cards;
+        cards += pos->num_cards[i];
+        any_empty |= pos->num_cards[i] == 0;
+    }
+
+    int n = 0;
+    for (int from = 0; from < NUM_PILES; from++) {
+        int len = pos->num_cards[from];
+        int run = KERNEL(run_len)(pos, starts[from], from);
+        if (run == 0) {
+            continue;
+        }
+        int top_rank = K_RANK(starts[from][len - 1]);
+        for (int to = 0; to < NUM_PILES; to++) {
+            if (to == from) {
+                continue;
+            }
+            int dst_len = pos->num_cards[to];
+            if (dst_len == 0) {
+                for (int count = 1; count <= run; count++) {
+                    moves[n++] = (Move){ from, to, count };
+                }
+                continue;
+            }
+            /* Only one length of run fits on a given card */
+            int count = K_RANK(starts[to][dst_len - 1]) - top_rank;
+            if (count >= 1 && count <= run) {
+                moves[n++] = (Move){ from, to, count };
+            }
+        }
+    }
+
+    /* As in the game, there's no dealing onto an empty pile */
+    if (pos->num_deals > 0 && !any_empty) {
+        moves[n++] = (Move){ DEAL_MOVE, 0, NUM_PILES };
+    }
+    return n;
+}
+
+static bool KERNEL(is_legal_move)(Position *pos, Move move)
+{
+    if (move.from == DEAL_MOVE) {
+        bool any_empty = false;
+        for (int i = 0; i < NUM_PILES; i++) {
+            any_empty |= pos->num_cards[i] == 0;
+        }
+        return pos->num_deals > 0 && !any_empty
+            && move.to == 0 && move.count == NUM_PILES;
+    }
+    if (move.from >= NUM_PILES || move.to >= NUM_PILES || move.from == move.to) {
+        return false;
+    }
+    uint8_t *src = pile_cards(pos, move.from);
+    if (move.count < 1 || move.count > KERNEL(run_len)(pos, src, move.from)) {
+        return false;
+    }
+    int dst_len = pos->num_cards[move.to];
+    if (dst_len == 0) {
+        return true;
+    }
+    uint8_t bottom = src[pos->num_cards[move.from] - move.count];
+    uint8_t onto = pile_cards(pos, move.to)[dst_len - 1];
+    return K_RANK(onto) == K_RANK(bottom) + 1;
+}
+
+/*
+ * Clears away a king to ace run of one suit from the top of a pile.
+ */
+static void KERNEL(check_complete)(Position *pos, int pile)
+{
+    int len = pos->num_cards[pile];
+    if (len - pos->num_facedown[pile] < 13) {
+        return;
+    }
+    uint8_t *cards = pile_cards(pos, pile) + len - 13;
+    for (int i = 0; i < 13; i++) {
+        if (cards[i] != cards[0] - i || K_RANK(cards[0]) != 12) {
+            return;
+        }
+    }
+    take_cards(pos, pile, 13, NULL);
+    pos->num_completed++;
+    flip_top(pos, pile);
+}
+
+static void KERNEL(apply_move)(Position *pos, Move move)
+{
+    if (move.from == DEAL_MOVE) {
+        uint8_t *deal = &pos->stock[(pos->num_deals - 1) * NUM_PILES];
+        for (int i = 0; i < NUM_PILES; i++) {
+            put_cards(pos, i, 1, &deal[i]);
+        }
+        pos->num_deals--;
+        return;
+    }
+    uint8_t cards[13];
+    take_cards(pos, move.from, move.count, cards);
+    flip_top(pos, move.from);
+    put_cards(pos, move.to, move.count, cards);
+    KERNEL(check_complete)(pos, move.to);
+}
+
+static int KERNEL(evaluate)(Position *pos, const EvalWeights *weights)
+{
+    int empty = 0;
+    int facedown = 0;
+    int run = 0;
+    uint8_t *cards = pos->cards;
+    for (int i = 0; i < NUM_PILES; i++) {
+        int len = pos->num_cards[i];
+        empty += len == 0;
+        facedown += pos->num_facedown[i];
+        for (int j = pos->num_facedown[i]; j < len - 1; j++) {
+            run += cards[j + 1] == cards[j] - 1 && K_RANK(cards[j]) > 0;
+        }
+        cards += len;
+    }
+    return weights->completed * pos->num_completed + weights->empty * empty
+        + weights->facedown * facedown + weights->run * run
+        + weights->stock * pos->num_deals * NUM_PILES;
+}
+
+static void KERNEL(search_from)(
+        Search *s,
+        Position *pos,
+        int depth,
+        Move first,
+        const PathNode *path)
+{
+    Move moves[MAX_MOVES];
+    int num_moves = KERNEL(legal_moves)(pos, moves);
+    int first_empty = first_empty_pile(pos);
+    for (int i = 0; i < num_moves && !should_stop(s); i++) {
+        PruneRule rule;
+        if (prune_move(pos, moves[i], first_empty, path->move, path->reversible, &rule)) {
+            s->result.pruned[rule]++;
+            continue;
+        }
+        Position next = *pos;
+        KERNEL(apply_move)(&next, moves[i]);
+        PathNode node = { path, &next, moves[i], is_reversible(pos, &next, moves[i]) };
+        /*
+         * A move always changes the two piles it is between, so a cycle
+         * closes two moves back at the nearest. At the last depth one does
+         * no harm, as it scores the same as the shorter line to it did.
+         */
+        bool leaf = depth + 1 >= s->depth_limit;
+        if (!leaf && node.reversible && path->reversible && on_path(path->parent, &next)) {
+            s->result.pruned[PRUNE_CYCLE]++;
+            continue;
+        }
+        s->result.nodes++;
+
+        Move line = depth == 0 ? moves[i] : first;
+        int score = KERNEL(evaluate)(&next, &DEFAULT_WEIGHTS);
+        if (!s->result.found || score > s->result.score) {
+            s->result.found = true;
+            s->result.best = line;
+            s->result.score = score;
+        }
+        if (!leaf) {
+            KERNEL(search_from)(s, &next, depth + 1, line, &node);
+        }
+    }
+}
+
+#undef K_SUIT
+#undef K_RANK
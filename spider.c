@@ -4,41 +4,22 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
 #include "graphics.h"
+#include "hint.h"
+#include "layout.h"
+#include "rules.h"
+#include "replay.h"
+#include "snapshot.h"
+#include "table.h"
 
-/*
- * Whether or not a card pile can be picked up
- */
-int can_pick_up(Pile *src, int idx)
-{
-    /* Don't allow moving facedown cards */
-    if (src->cards[idx].orientation == FACEDOWN) {
-        return false;
-    }
-    Card *prev_card;
-    Card *curr_card;
-    for (int i = idx; i < src->num_cards - 1; i++) {
-        prev_card = &src->cards[i];
-        curr_card = &src->cards[i + 1];
-        if (curr_card->suit != prev_card->suit
-                || curr_card->rank != prev_card->rank - 1) {
-            return false;
-        }
-    }
-    return true;
-}
+/* Frames each move of a replay stays on screen at normal speed */
+#define REPLAY_MOVE_FRAMES 8
 
-/*
- * Whether or not a card pile can be set down
- */
-int can_place(Pile *src, Pile *dst)
-{
-    int src_val = src->cards[0].rank;
-    int dst_val = dst->cards[dst->num_cards - 1].rank;
-    return (src_val == dst_val - 1 || dst->num_cards == 0);
-}
+/* How often a game in progress is saved, besides on exit */
+#define SNAPSHOT_INTERVAL_MS 5000
 
 /*
  * Whether or not the mouse is hovering over the deal piles
@@ -58,80 +39,137 @@ bool is_over_deal_piles(Graphics *graphics, int num_deal_piles)
 }
 
 /*
- * Deals the next set of cards and returns the remaining number of piles to
- * be dealt.
+ * Captures the game for saving. Cards being dragged must be put back first.
  */
-int deal_next_set(
+void take_snapshot(
+        Snapshot *snapshot,
+        uint32_t seed,
         Pile piles[],
         Pile deal_piles[],
-        int num_piles,
-        int num_deal_piles)
+        Pile goal_piles[],
+        int num_deal_piles,
+        int num_completed_piles,
+        int num_suits)
 {
-    /* Don't deal if there are empty spaces */
-    int i = 0;
-    for (; i < num_piles; i++) {
-        if (piles[i].num_cards == 0) {
-            return num_deal_piles;
-        }
+    memset(snapshot, 0, sizeof(*snapshot));
+    snapshot->seed = seed;
+    make_position(
+            &snapshot->table,
+            piles,
+            deal_piles,
+            num_deal_piles,
+            num_completed_piles,
+            num_suits);
+    for (int i = 0; i < num_completed_piles; i++) {
+        snapshot->goal_suits[i] = goal_piles[i].cards[0].suit;
+    }
+}
+
+/*
+ * Picks one of the seeds listed in a file, such as a pool written by
+ * spider-classify. Each seed is equally likely, with the file read once.
+ */
+bool pick_seed(const char *path, uint32_t *seed)
+{
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        return false;
     }
-    if (num_deal_piles > 0) {
-        i = 0;
-        Pile *xs = &deal_piles[num_deal_piles - 1];
-        for (; xs->num_cards > 0; i++) {
-            Pile *s = &piles[i % num_piles];
-            s->cards[s->num_cards] = xs->cards[xs->num_cards - 1];
-            s->cards[s->num_cards].orientation = FACEUP;
-            s->num_cards++;
-            xs->num_cards--;
+    unsigned long n = 0;
+    unsigned long value;
+    while (fscanf(f, "%lu", &value) == 1) {
+        n++;
+        if (rand() % n == 0) {
+            *seed = value;
         }
     }
-    return num_deal_piles - 1;
+    fclose(f);
+    return n > 0;
 }
 
 /*
- * Checks if the source pile contains a full series from king to ace of one 
- * suit. If so, it moves the series to the destination pile, and returns
- * true. Otherwise it returns false.
+ * Where the game in progress is kept between runs, or NULL if there is
+ * nowhere to keep it. Must be freed with SDL_free.
  */
-int check_complete(Pile *srcpile, Pile *dstpile)
+char *snapshot_path()
 {
-    for (int i = 0; i < srcpile->num_cards; i++) {
-        if (srcpile->cards[i].rank == 12) {
-            /* We found a king */
-            int j = i + 1;
-            int target_rank = 11;
-            int target_suit = srcpile->cards[i].suit;
-            /*
-             * Crawl down the pile to see if it's complete and in
-             * descending order
-             */
-            while (j < srcpile->num_cards) {
-                if (srcpile->cards[j].rank != target_rank
-
-
-                        || srcpile->cards[j].suit  != target_suit) {
-                    break;
-                }
-                if (target_rank == 0) {
-                    /* We made it to the ace */
-                    move_pile(srcpile, dstpile, i);
-                    if (srcpile->num_cards > 0) {
-                        srcpile->cards[i - 1].orientation = FACEUP;
-                    }
-                    return true;
-                }
-                target_rank--;
-                j++;
-            }
-        }
+    char *dir = SDL_GetPrefPath("solitaire", "spider");
+    if (!dir) {
+        return NULL;
+    }
+    size_t len = strlen(dir) + strlen("spider.snapshot") + 1;
+    char *path = SDL_malloc(len);
+    if (path) {
+        snprintf(path, len, "%sspider.snapshot", dir);
     }
-    return false;
+    SDL_free(dir);
+    return path;
 }
 
 int main(int argc, char* argv[]) {
+    /*
+     * With --suits 1, 2 or 4, deal a game with that many suits instead of
+     * carrying on the last one, and with --seeds FILE, deal one of the
+     * seeds listed in FILE, one of spider-classify's pools say. With
+     * --record FILE, the game is added to FILE as a replay on exit. With
+     * --replay FILE, the first Spider game in FILE plays itself out
+     * instead, --speed X times as fast as normal.
+     */
+    const char *record_path = NULL;
+    const char *replay_path = NULL;
+    const char *seeds_path = NULL;
+    float speed = 1.0f;
+    int num_suits = 4;
+    bool suits_chosen = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--suits") == 0 && i + 1 < argc) {
+            int suits = atoi(argv[++i]);
+            if (suits == 1 || suits == 2 || suits == 4) {
+                num_suits = suits;
+                suits_chosen = true;
+            }
+        } else if (strcmp(argv[i], "--seeds") == 0 && i + 1 < argc) {
+            seeds_path = argv[++i];
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            record_path = argv[++i];
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replay_path = argv[++i];
+        } else if (strcmp(argv[i], "--speed") == 0 && i + 1 < argc) {
+            speed = atof(argv[++i]);
+            speed = speed > 0 ? speed : 1.0f;
+        }
+    }
+
     /* Seed the random number generator */
     srand(time(NULL));
 
+    uint32_t listed_seed = 0;
+    bool seed_chosen = seeds_path && !replay_path && pick_seed(seeds_path, &listed_seed);
+    if (seeds_path && !seed_chosen && !replay_path) {
+        printf("Couldn't read any seeds from %s\n", seeds_path);
+    }
+
+    /*
+     * The game being played back, with playback_pos the next move in it and
+     * the rules' view of the table, to check moves against
+     */
+    Replay playback = {0};
+    size_t playback_pos = 0;
+    Position playback_table;
+    bool replaying = false;
+    float replay_frames = 0;
+    if (replay_path) {
+        FILE *f = fopen(replay_path, "rb");
+        replaying = f && replay_read(&playback, f) == 1
+            && playback.header.variant == REPLAY_SPIDER;
+        if (!replaying) {
+            printf("Couldn't read a Spider replay from %s\n", replay_path);
+        }
+        if (f) {
+            fclose(f);
+        }
+    }
+
     /* Initialize SDL */
     if (SDL_Init(SDL_INIT_VIDEO != 0)) {
         SDL_Log("Failed to initialize SDL: %s", SDL_GetError());
@@ -153,36 +191,68 @@ int main(int argc, char* argv[]) {
     bool mouse_down = false;
     SDL_Event event;
 
+    /* Hints are searched for in the background and shown once found */
+    HintWorker hints;
+    bool hints_enabled = hint_init(&hints);
+    bool show_hint = false;
+    Move hint;
+
     int num_piles = 10; /* Number of piles in the main play area */
     int num_deal_piles = 5; /* Number of piles to be dealt from during play */
     int num_goal_piles = 8; /* Number of piles to put completed series */
     int num_completed_piles = 0; /* Number of series completed */
 
-    Card deck[104];
     Pile piles[num_piles];
     Pile deal_piles[num_deal_piles];
     Pile goal_piles[num_goal_piles];
+    /* Where the piles and deal piles are drawn, laid out again every frame */
+    SDL_Rect pile_rects[num_piles];
+    SDL_Rect deal_rects[num_deal_piles];
 
     update_graphics(&graphics, num_piles);
 
-    /* Create a deck from two standard 52-card decks of cards. */
-    for (int suit = 0; suit < 4; suit++) {
-        for (int rank = 0; rank < 13; rank++) {
-            Card card;
-            card.suit = suit;
-            card.rank = rank;
-            card.orientation = FACEUP;
-            deck[suit * 13 + rank] = card;
-            deck[52 + suit * 13 + rank] = card;
-        }
+    /*
+     * Unless playing a replay, pick up where the last game left off. A
+     * replay doesn't save over it, and a resumed game isn't recorded, since
+     * the moves before the snapshot are gone.
+     */
+    char *save_path = replay_path ? NULL : snapshot_path();
+    Snapshot snapshot = {0};
+    bool resumed = save_path && snapshot_load(save_path, &snapshot)
+        && snapshot.table.num_completed < NUM_COMPLETE
+        && (!suits_chosen || snapshot.table.num_suits == num_suits)
+        && !seed_chosen;
+    if (replaying) {
+        num_suits = playback.header.suits ? playback.header.suits : 4;
+    } else if (resumed) {
+        num_suits = snapshot.table.num_suits;
+    }
+
+    /*
+     * Games are dealt from a seed so that a replay only has to record the
+     * seed and the moves.
+     */
+    uint32_t seed = replaying ? playback.header.seed
+        : resumed ? snapshot.seed
+        : seed_chosen ? listed_seed : (uint32_t)rand();
+    Position start;
+    if (resumed) {
+        start = snapshot.table;
+    } else {
+        deal_position(&start, seed, num_suits);
     }
-    shuffle(deck, 104);
+    playback_table = start;
+    num_deal_piles = start.num_deals;
+    num_completed_piles = start.num_completed;
+    Replay replay = {0};
+    replay_start(&replay, REPLAY_SPIDER, seed);
+    replay.header.suits = num_suits;
 
     /* Create piles */
     int i;
     for (i = 0; i < num_piles; i++) {
         piles[i].num_cards = 0;
-        piles[i].rect = make_rect(
+        pile_rects[i] = make_rect(
                 graphics.width / num_piles * i,
                 graphics.card_h,
                 graphics.width / num_piles,
@@ -196,34 +266,25 @@ int main(int argc, char* argv[]) {
     }
 
     /* Populate piles */
-
-    /* Facedown cards */
-    i = 0;
-    for (; i < 44; i++) {
-        deck[i].orientation = FACEDOWN;
-        Pile *pile = &piles[i % num_piles];
-        pile->cards[pile->num_cards] = deck[i];
-        pile->num_cards++;
-    }
-    /* Faceup cards */
-    for (; i < 54; i++) {
-        Pile *pile = &piles[i % num_piles];
-        pile->cards[pile->num_cards] = deck[i];
-        pile->num_cards++;
-    }
-    /* deal piles */
-    for (; i < 104; i++) {
-        Pile *pile = &deal_piles[i % num_deal_piles];
-        pile->cards[pile->num_cards] = deck[i];
-        pile->cards[pile->num_cards].orientation = FACEDOWN;
-        pile->num_cards = pile->num_cards + 1;
+    set_table(&start, piles, deal_piles);
+    for (i = 0; i < num_completed_piles; i++) {
+        for (int rank = 12; rank >= 0; rank--) {
+            Card *card = &goal_piles[i].cards[goal_piles[i].num_cards++];
+            card->suit = snapshot.goal_suits[i];
+            card->rank = rank;
+            card->orientation = FACEUP;
+        }
     }
+    Snapshot saved;
+    take_snapshot(&saved, seed, piles, deal_piles, goal_piles,
+            num_deal_piles, num_completed_piles, num_suits);
+    Uint32 last_save = SDL_GetTicks();
 
     MouseTarget target;
     Pile mouse_pile;
     mouse_pile.num_cards = 0;
-    mouse_pile.rect = make_rect(0, 0, graphics.card_w, graphics.height);
-    update_mouse_pile(&graphics, &mouse_pile.rect);
+    SDL_Rect mouse_pile_rect = make_rect(0, 0, graphics.card_w, graphics.height);
+    update_mouse_pile(&graphics, &mouse_pile_rect);
 
     int src_pile_idx = 0;
     int dst_pile_idx = 0;
@@ -249,24 +310,39 @@ int main(int argc, char* argv[]) {
                      * fixes issue where a touch event would send a duplicate click
                      * event.
                      */
-                    if (!mouse_down) {
+                    if (replaying) {
+                        /* Any click stops a replay where it is */
+                        replaying = false;
                         mouse_down = true;
+                    } else if (!mouse_down) {
+                        mouse_down = true;
+                        /* Whatever the click does, the hint no longer applies */
+                        if (hints_enabled) {
+                            hint_cancel(&hints);
+                        }
+                        show_hint = false;
                         if (can_pick_up(&piles[target.pile], target.card)) {
                             src_pile_idx = target.pile;
                             move_pile(&piles[target.pile], &mouse_pile, target.card);
                             set_mouse_target(
                                     &graphics,
                                     &piles[target.pile],
-                                    &(piles[target.pile].rect),
+                                    &pile_rects[target.pile],
                                     &mouse_pile,
-                                    &(mouse_pile.rect),
+                                    &mouse_pile_rect,
                                     target.card);
                         } else if (is_over_deal_piles(&graphics, num_deal_piles)) {
-                            num_deal_piles = deal_next_set(
+                            int dealt = deal_next_set(
                                     piles,
                                     deal_piles,
                                     num_piles,
                                     num_deal_piles);
+                            if (dealt != num_deal_piles) {
+                                replay_record(
+                                        &replay,
+                                        (Move){ DEAL_MOVE, 0, NUM_PILES });
+                            }
+                            num_deal_piles = dealt;
                         }
                     }
                     break;
@@ -274,7 +350,16 @@ int main(int argc, char* argv[]) {
                 case SDL_FINGERUP:
                     mouse_down = false;
                     dst_pile_idx = target.pile;
+                    if (mouse_pile.num_cards == 0) {
+                        break;
+                    }
                     if (can_place(&mouse_pile, &piles[target.pile])) {
+                        if (dst_pile_idx != src_pile_idx) {
+                            replay_record(&replay, (Move){
+                                    src_pile_idx,
+                                    dst_pile_idx,
+                                    mouse_pile.num_cards });
+                        }
                         move_pile(&mouse_pile, &piles[target.pile], 0);
                         if (check_complete(&piles[target.pile],
                                     &goal_piles[num_completed_piles])) {
@@ -298,42 +383,96 @@ int main(int argc, char* argv[]) {
                 case SDL_MOUSEMOTION:
                     SDL_GetMouseState(&graphics.mouse_x, &graphics.mouse_y);
                     break;
+                case SDL_KEYDOWN:
+                    if (replaying) {
+                        replaying = false;
+                    } else if (event.key.keysym.sym == SDLK_h && hints_enabled
+                            && mouse_pile.num_cards == 0) {
+                        show_hint = false;
+                        hint_request(
+                                &hints,
+                                piles,
+                                deal_piles,
+                                num_deal_piles,
+                                num_completed_piles,
+                                num_suits);
+                    }
+                    break;
 
             }
         }
 
-        SDL_Rect rects[num_piles];
-        for (int i = 0; i < num_piles; i++) {
-            rects[i] = piles[i].rect;
+        if (hints_enabled && hint_poll(&hints, &hint)) {
+            show_hint = true;
         }
-        target = get_mouse_target(&graphics, piles, rects, num_piles);
 
-        update_mouse_pile(&graphics, &mouse_pile.rect);
+        if (save_path && mouse_pile.num_cards == 0
+                && SDL_GetTicks() - last_save >= SNAPSHOT_INTERVAL_MS) {
+            Snapshot now;
+            take_snapshot(&now, seed, piles, deal_piles, goal_piles,
+                    num_deal_piles, num_completed_piles, num_suits);
+            if (memcmp(&now, &saved, sizeof(now)) != 0
+                    && snapshot_save(save_path, &now)) {
+                saved = now;
+            }
+            last_save = SDL_GetTicks();
+        }
+
+        if (replaying) {
+            /* Fast enough, several moves land in one frame */
+            replay_frames += speed;
+            while (replaying && replay_frames >= REPLAY_MOVE_FRAMES) {
+                replay_frames -= REPLAY_MOVE_FRAMES;
+                Move move;
+                if (!replay_next(&playback, &playback_pos, &move)) {
+                    replaying = false;
+                    break;
+                }
+                if (!is_legal_move(&playback_table, move)) {
+                    printf("Replay move %u is illegal\n", replay.header.num_moves + 1);
+                    replaying = false;
+                    break;
+                }
+                apply_move(&playback_table, move);
+                play_move(
+                        piles,
+                        deal_piles,
+                        goal_piles,
+                        &num_deal_piles,
+                        &num_completed_piles,
+                        move);
+                replay_record(&replay, move);
+            }
+        }
+
+        target = get_mouse_target(&graphics, piles, pile_rects, num_piles);
+
+        update_mouse_pile(&graphics, &mouse_pile_rect);
         update_graphics(&graphics, num_piles);
 
         int offset = graphics.margin * 2;
 
         for (i = 0; i < num_piles; i++) {
-            piles[i].rect = make_rect(
+            pile_rects[i] = make_rect(
                     graphics.width / num_piles * i,
                     graphics.card_h,
                     graphics.width / num_piles,
                     graphics.height - graphics.card_h);
-            draw_pile(&graphics, &piles[i], &(piles[i].rect));
+            draw_pile(&graphics, &piles[i], &pile_rects[i]);
         }
 
         for (i = 0; i < num_deal_piles; i++) {
-            deal_piles[i].rect = make_rect(
+            deal_rects[i] = make_rect(
                     offset * i + graphics.margin,
                     graphics.margin,
                     graphics.width / num_piles - (graphics.margin * 2),
                     graphics.card_h - (graphics.margin * 2));
-            draw_card(&graphics, &deal_piles[i].cards[0], &(deal_piles[i].rect));
+            draw_card(&graphics, &deal_piles[i].cards[0], &deal_rects[i]);
         }
 
         for (i = 0; i < num_goal_piles; i++) {
             if (goal_piles[i].num_cards > 0) {
-                goal_piles[i].rect = make_rect(
+                SDL_Rect goal_rect = make_rect(
                         graphics.width - graphics.card_w - (offset * i),
                         graphics.margin,
                         graphics.width / num_piles - (graphics.margin * 2),
@@ -341,15 +480,52 @@ int main(int argc, char* argv[]) {
                 draw_card(
                         &graphics,
                         &goal_piles[i].cards[0],
-                        &(goal_piles[i].rect));
+                        &goal_rect);
             }
         }
 
-        draw_pile(&graphics, &mouse_pile, &(mouse_pile.rect));
+        if (show_hint) {
+            if (hint.from == DEAL_MOVE) {
+                draw_outline(&graphics, &deal_rects[num_deal_piles - 1]);
+            } else {
+                Pile *src = &piles[hint.from];
+                Pile *dst = &piles[hint.to];
+                SDL_Rect src_rect = get_card_rect(
+                        &graphics, src, &pile_rects[hint.from], src->num_cards - hint.count);
+                SDL_Rect dst_rect = get_card_rect(
+                        &graphics,
+                        dst,
+                        &pile_rects[hint.to],
+                        dst->num_cards > 0 ? dst->num_cards - 1 : 0);
+                draw_outline(&graphics, &src_rect);
+                draw_outline(&graphics, &dst_rect);
+            }
+        }
+
+        draw_pile(&graphics, &mouse_pile, &mouse_pile_rect);
         SDL_RenderPresent(graphics.renderer);
     }
 
     /* Clean up */
+    if (save_path) {
+        /* Cards still being dragged go back where they came from */
+        move_pile(&mouse_pile, &piles[src_pile_idx], 0);
+        take_snapshot(&snapshot, seed, piles, deal_piles, goal_piles,
+                num_deal_piles, num_completed_piles, num_suits);
+        if (!snapshot_save(save_path, &snapshot)) {
+            printf("Couldn't save the game to %s\n", save_path);
+        }
+        SDL_free(save_path);
+    }
+    if (record_path && !resumed && replay.header.num_moves > 0
+            && !replay_append(&replay, record_path)) {
+        printf("Couldn't write replay to %s\n", record_path);
+    }
+    replay_free(&replay);
+    replay_free(&playback);
+    if (hints_enabled) {
+        hint_free(&hints);
+    }
     graphics_free(&graphics);
     IMG_Quit();
     SDL_Quit();
@@ -0,0 +1,66 @@
+#include <string.h>
+
+#include "table.h"
+
+/*
+ * Copies the table into the solver's compact form.
+ */
+void make_position(
+        Position *pos,
+        Pile piles[],
+        Pile deal_piles[],
+        int num_deal_piles,
+        int num_completed,
+        int num_suits)
+{
+    memset(pos, 0, sizeof(*pos));
+    int n = 0;
+    for (int i = 0; i < NUM_PILES; i++) {
+        for (int j = 0; j < piles[i].num_cards; j++) {
+            Card card = piles[i].cards[j];
+            pos->cards[n++] = card.suit * 13 + card.rank;
+            if (card.orientation == FACEDOWN) {
+                pos->num_facedown[i]++;
+            }
+        }
+        pos->num_cards[i] = piles[i].num_cards;
+    }
+    /* deal_next_set hands out a deal pile's cards from the top down */
+    for (int i = 0; i < num_deal_piles; i++) {
+        for (int j = 0; j < NUM_PILES; j++) {
+            Card card = deal_piles[i].cards[NUM_PILES - 1 - j];
+            pos->stock[i * NUM_PILES + j] = card.suit * 13 + card.rank;
+        }
+    }
+    pos->num_deals = num_deal_piles;
+    pos->num_completed = num_completed;
+    pos->num_suits = num_suits;
+}
+
+/*
+ * Lays out a position on the table, the other way round from make_position.
+ */
+void set_table(Position *pos, Pile piles[], Pile deal_piles[])
+{
+    uint8_t *cards = pos->cards;
+    for (int i = 0; i < NUM_PILES; i++) {
+        piles[i].num_cards = pos->num_cards[i];
+        for (int j = 0; j < pos->num_cards[i]; j++) {
+            piles[i].cards[j].suit = cards[j] / 13;
+            piles[i].cards[j].rank = cards[j] % 13;
+            piles[i].cards[j].orientation =
+                j < pos->num_facedown[i] ? FACEDOWN : FACEUP;
+        }
+        cards += pos->num_cards[i];
+    }
+    /* deal_next_set hands out a deal pile's cards from the top down */
+    for (int i = 0; i < pos->num_deals; i++) {
+        deal_piles[i].num_cards = NUM_PILES;
+        for (int j = 0; j < NUM_PILES; j++) {
+            Card *card = &deal_piles[i].cards[NUM_PILES - 1 - j];
+            card->suit = pos->stock[i * NUM_PILES + j] / 13;
+            card->rank = pos->stock[i * NUM_PILES + j] % 13;
+            card->orientation = FACEDOWN;
+        }
+    }
+}
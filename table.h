@@ -0,0 +1,21 @@
+#ifndef TABLE_H
+#define TABLE_H
+
+#include "cards.h"
+#include "solver.h"
+
+/*
+ * Conversions between the table as drawn and the solver's compact Position,
+ * which is also what gets saved.
+ */
+
+void make_position(
+        Position *pos,
+        Pile piles[],
+        Pile deal_piles[],
+        int num_deal_piles,
+        int num_completed,
+        int num_suits);
+void set_table(Position *pos, Pile piles[], Pile deal_piles[]);
+
+#endif